@@ -2,104 +2,292 @@
 //  Timer.h
 //  NibbleAndAHalf
 //
+//  Timers for short calls: a monotonic std::chrono::steady_clock backend, and on x86 a
+//  serialized time stamp counter backend whose ticks are calibrated to nanoseconds.
+//
+//    base64::timing::timer total;
+//
+//    for (auto const& token : tokens) {
+//        total.start();
+//        base64::decode(token);
+//        total.stop();
+//    }
+//
+//    total.nanoseconds() / total.laps()   // mean per call, clock overhead removed
+//
+//  A timer is not shared between threads; give each thread its own and add them up.
+//
+
+#pragma once
 
-#ifndef TIMER_H
-#define TIMER_H
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
 
-#ifdef _WIN32
-#include <Windows.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define BASE64_TIMER_TSC 1
 #else
-#include <sys/time.h>
+#define BASE64_TIMER_TSC 0
+#endif
+
+namespace base64::timing {
+
+	// Ticks of std::chrono::steady_clock, which never goes backwards, unlike the
+	// wall clock gettimeofday() reads.
+	struct steady_clock {
+		static constexpr bool serialized = false;
+
+		static std::uint64_t start() noexcept {
+			return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+		}
+
+		static std::uint64_t stop() noexcept {
+			return start();
+		}
+
+		static bool available() noexcept {
+			return true;
+		}
+
+		static double nanoseconds_per_tick() noexcept {
+			return 1e9 * static_cast<double>(std::chrono::steady_clock::period::num)
+				/ static_cast<double>(std::chrono::steady_clock::period::den);
+		}
+	};
+
+#if BASE64_TIMER_TSC
+	// The time stamp counter, read so that the timed code can neither start before
+	// start() nor still be running at stop(): lfence orders the first rdtsc after
+	// everything before it, rdtscp waits for everything before it to finish, and the
+	// lfence after each keeps later instructions from starting early.
+	//
+	// It counts at a fixed reference rate, which is not the core clock while the core
+	// runs above or below its nominal frequency.
+	struct tsc_clock {
+		static constexpr bool serialized = true;
+
+		static std::uint64_t start() noexcept {
+			_mm_lfence();
+			std::uint64_t const ticks = __rdtsc();
+			_mm_lfence();
+
+			return ticks;
+		}
+
+		static std::uint64_t stop() noexcept {
+			unsigned int processor;
+			std::uint64_t const ticks = __rdtscp(&processor);
+			_mm_lfence();
+
+			return ticks;
+		}
+
+		// rdtscp exists and the counter rate does not change with power states.
+		static bool available() noexcept {
+			static bool const usable = [] {
+				unsigned int eax, ebx, ecx, edx;
+
+				if ( 0 == __get_cpuid(0x80000001u, &eax, &ebx, &ecx, &edx) || 0u == (edx & (1u << 27u)) ) {
+					return false;
+				}
+
+				if ( 0 == __get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx) || 0u == (edx & (1u << 8u)) ) {
+					return false;
+				}
+
+				return true;
+			}();
+
+			return usable;
+		}
+
+		// Measured against steady_clock over 20 ms on first use.
+		static double nanoseconds_per_tick() noexcept {
+			static double const calibrated = [] {
+				auto const wall_start = std::chrono::steady_clock::now();
+				std::uint64_t const tick_start = start();
+
+				while ( std::chrono::steady_clock::now() - wall_start < std::chrono::milliseconds(20) ) {
+				}
+
+				std::uint64_t const tick_stop = stop();
+				auto const wall_stop = std::chrono::steady_clock::now();
+
+				return std::chrono::duration<double, std::nano>(wall_stop - wall_start).count()
+					/ static_cast<double>(tick_stop - tick_start);
+			}();
+
+			return calibrated;
+		}
+	};
 #endif
 
-#ifdef __cplusplus
-// TIMER class, only available if C++ available
-class Timer
-{
-  #ifdef _WIN32
-  LARGE_INTEGER startTime ;
-  double fFreq ;
-  #else
-  timeval startTime ;
-  #endif
-  
-public:
-  Timer() {
-    #ifdef _WIN32
-    LARGE_INTEGER freq ;
-    QueryPerformanceFrequency( &freq ) ;
-    fFreq = (double)freq.QuadPart ;
-    #else
-    gettimeofday( &startTime, NULL ) ;
-    #endif
-    reset();
-  }
-
-  void reset() {
-    #ifdef _WIN32
-    QueryPerformanceCounter( &startTime ) ;
-    #else
-    gettimeofday( &startTime, NULL ) ;
-    #endif
-  }
-
-  // Gets the most up to date time.
-  double getTime() const {
-    #ifdef _WIN32
-    LARGE_INTEGER endTime ;
-    QueryPerformanceCounter( &endTime ) ;
-    return ( endTime.QuadPart - startTime.QuadPart ) / fFreq ; // as double
-    #else
-    timeval endTime ;
-    gettimeofday( &endTime, NULL ) ;
-    return (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1e6 ;
-    #endif
-  }
-} ;
+	// Reference cycles per nanosecond, from the time stamp counter; 0 where there is none.
+	inline double cycles_per_nanosecond() noexcept {
+#if BASE64_TIMER_TSC
+		if ( tsc_clock::available() ) {
+			return 1.0 / tsc_clock::nanoseconds_per_tick();
+		}
 #endif
 
-// These timing functions are always available
-typedef struct _CTimer
-{
-  #ifdef _WIN32
-  LARGE_INTEGER startTime ;
-  double fFreq ;
-  #else
-  struct timeval startTime ;
-  #endif
-} CTimer ;
-
-void CTimerReset( CTimer* ctimer ) {
-  #ifdef _WIN32
-  QueryPerformanceCounter( &ctimer->startTime ) ;
-  #else
-  gettimeofday( &ctimer->startTime, NULL ) ;
-  #endif
-}
-
-void CTimerInit( CTimer* ctimer ) {
-  #ifdef _WIN32
-  LARGE_INTEGER freq ;
-  QueryPerformanceFrequency( &freq ) ;
-  ctimer->fFreq = (double)freq.QuadPart ;
-  #else
-  gettimeofday( &ctimer->startTime, NULL ) ;
-  #endif
-  CTimerReset( ctimer );
-}
-
-// Gets the most up to date time.
-double CTimerGetTime( CTimer* ctimer ) {
-  #ifdef _WIN32
-  LARGE_INTEGER endTime ;
-  QueryPerformanceCounter( &endTime ) ;
-  return ( endTime.QuadPart - ctimer->startTime.QuadPart ) / ctimer->fFreq ; // as double
-  #else
-  struct timeval endTime ;
-  gettimeofday( &endTime, NULL ) ;
-  return (endTime.tv_sec - ctimer->startTime.tv_sec) + (endTime.tv_usec - ctimer->startTime.tv_usec)/1e6 ;
-  #endif
-}
+		return 0.0;
+	}
+
+	// Accumulates laps: every start() / stop() pair adds one, lap() ends the current one
+	// and starts the next at the same tick. Reading the clock costs a few tens of
+	// nanoseconds, which would swamp a call on a short token, so that cost is measured
+	// once per clock and taken off every lap.
+	template<typename Clock>
+	class basic_timer {
+		std::uint64_t started = 0u;
+		std::uint64_t total = 0u;
+		std::uint64_t shortest = std::numeric_limits<std::uint64_t>::max();
+		std::uint64_t longest = 0u;
+		std::uint64_t lap_count = 0u;
+
+		void _add(
+			std::uint64_t const ticks
+		) noexcept {
+			total += ticks;
+			shortest = std::min(shortest, ticks);
+			longest = std::max(longest, ticks);
+			++lap_count;
+		}
 
+		double _nanoseconds(
+			std::uint64_t const ticks
+		) const noexcept {
+			return static_cast<double>(ticks) * Clock::nanoseconds_per_tick();
+		}
 
+	public:
+		using clock = Clock;
+
+		// Fewest ticks a start() / stop() pair around nothing has taken.
+		static std::uint64_t overhead() noexcept {
+			static std::uint64_t const measured = [] {
+				std::uint64_t fewest = std::numeric_limits<std::uint64_t>::max();
+
+				for (int i = 0; i < 1000; ++i) {
+					std::uint64_t const begin = Clock::start();
+					std::uint64_t const end = Clock::stop();
+
+					fewest = std::min(fewest, end - begin);
+				}
+
+				return fewest;
+			}();
+
+			return measured;
+		}
+
+		void start() noexcept {
+			started = Clock::start();
+		}
+
+		// Ends the lap, returns its ticks (less the overhead).
+		std::uint64_t stop() noexcept {
+			std::uint64_t const stopped = Clock::stop();
+			std::uint64_t const ticks = stopped - started;
+			std::uint64_t const cost = overhead();
+			std::uint64_t const lap_ticks = ticks > cost ? ticks - cost : 0u;
+
+			_add(lap_ticks);
+
+			return lap_ticks;
+		}
+
+		// Ends the lap and starts the next one, returns the ticks of the one ended.
+		std::uint64_t lap() noexcept {
+			std::uint64_t const stopped = Clock::stop();
+			std::uint64_t const ticks = stopped - started;
+			std::uint64_t const cost = overhead();
+			std::uint64_t const lap_ticks = ticks > cost ? ticks - cost : 0u;
+
+			started = stopped;
+			_add(lap_ticks);
+
+			return lap_ticks;
+		}
+
+		void reset() noexcept {
+			*this = basic_timer();
+		}
+
+		// Adds another timer's laps, e.g. one from each thread.
+		basic_timer& operator+=(
+			basic_timer const& other
+		) noexcept {
+			total += other.total;
+			shortest = std::min(shortest, other.shortest);
+			longest = std::max(longest, other.longest);
+			lap_count += other.lap_count;
+
+			return *this;
+		}
+
+		std::uint64_t laps() const noexcept {
+			return lap_count;
+		}
+
+		std::uint64_t ticks() const noexcept {
+			return total;
+		}
+
+		double nanoseconds() const noexcept {
+			return _nanoseconds(total);
+		}
+
+		double seconds() const noexcept {
+			return nanoseconds() * 1e-9;
+		}
+
+		// Reference cycles of the time stamp counter, 0 where there is none.
+		double cycles() const noexcept {
+			return nanoseconds() * cycles_per_nanosecond();
+		}
+
+		double shortest_nanoseconds() const noexcept {
+			return 0u == lap_count ? 0.0 : _nanoseconds(shortest);
+		}
+
+		double longest_nanoseconds() const noexcept {
+			return _nanoseconds(longest);
+		}
+
+		double mean_nanoseconds() const noexcept {
+			return 0u == lap_count ? 0.0 : nanoseconds() / static_cast<double>(lap_count);
+		}
+	};
+
+	// Times its own scope as one lap of `timer`.
+	template<typename Clock>
+	class scoped_lap {
+		basic_timer<Clock>& timer;
+
+	public:
+		explicit scoped_lap(
+			basic_timer<Clock>& timer
+		) noexcept : timer(timer) {
+			timer.start();
+		}
+
+		scoped_lap(scoped_lap const&) = delete;
+		scoped_lap& operator=(scoped_lap const&) = delete;
+
+		~scoped_lap() {
+			timer.stop();
+		}
+	};
+
+	using timer = basic_timer<steady_clock>;
+
+#if BASE64_TIMER_TSC
+	// Check tsc_clock::available() before relying on it.
+	using tsc_timer = basic_timer<tsc_clock>;
 #endif
+
+} // namespace base64::timing
@@ -0,0 +1,676 @@
+//
+//  b64.cpp
+//  NibbleAndAHalf
+//
+//  base64 on the command line, built on base64.hpp, for POSIX systems.
+//
+//    g++ -std=c++20 -O2 b64.cpp -o b64
+//    ./b64 [-d] [-w COLS] [--mmap-output] [--no-advise] [--huge-pages] [INPUT|- [OUTPUT]]
+//
+//  Like coreutils base64: encodes INPUT (standard input by default) to OUTPUT (standard output
+//  by default), wrapped at 76 columns, or with -d decodes it, ignoring whitespace.
+//
+//  Input that is a regular file (named, or redirected to standard input) is mapped into memory
+//  and read with madvise(MADV_SEQUENTIAL) hints; anything else (pipes, sockets, terminals) is
+//  read() a chunk at a time. The output goes out with write() from a reused buffer, or with
+//  --mmap-output straight into a mapping of the OUTPUT file, which is grown to the largest
+//  possible size first and cut to the real size at the end. --huge-pages asks for huge pages
+//  for the buffer (MAP_HUGETLB, else MADV_HUGEPAGE) and for the mappings (MADV_HUGEPAGE,
+//  which for files depends on the file system).
+//
+
+#include "base64.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+	using namespace base64::detail;
+
+	// Input bytes (for decoding, characters) handled per step, and the size of the read() buffer,
+	// unless a single encoded line is longer.
+	constexpr usize chunk_size = usize { 1u } << 22u;
+
+	[[noreturn]] void fail(
+		std::string const& what
+	) {
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+
+	struct options {
+		mut<bool> decode = false;
+		// 0 for one long line
+		mut<usize> wrap = 76u;
+		mut<bool> mmap_output = false;
+		mut<bool> advise = true;
+		mut<bool> huge_pages = false;
+		std::string input = "-";
+		std::string output = "-";
+	};
+
+	// Input bytes (for decoding, characters) handled per step. Encoding takes whole lines,
+	// so at least one, however long.
+	usize step_length(
+		options const& settings
+	) noexcept {
+		if ( settings.decode ) {
+			return chunk_size;
+		}
+
+		usize line_length = 0u == settings.wrap ? 3u : settings.wrap / 4u * 3u;
+
+		return std::max(line_length, chunk_size / line_length * line_length);
+	}
+
+	// The most a step of `length` input bytes (for decoding, characters) writes.
+	usize step_output_length(
+		options const& settings,
+		usize length
+	) {
+		if ( settings.decode ) {
+			return base64::decoder::max_update_length(length);
+		}
+
+		if ( 0u == settings.wrap ) {
+			return encoded_length(length);
+		}
+
+		// and the newline after the last line
+		return encoded_length(length, line_format(settings.wrap, u8"\n")) + 1u;
+	}
+
+	// Memory from mmap(), unmapped on destruction.
+	class mapping {
+		char8_t* data = nullptr;
+		mut<usize> length = 0u;
+
+	public:
+		mapping() noexcept = default;
+
+		mapping(
+			void* const address,
+			usize length
+		) noexcept : data(static_cast<char8_t*>(address)), length(length) {
+		}
+
+		mapping(mapping const&) = delete;
+		mapping& operator=(mapping const&) = delete;
+
+		mapping(
+			mapping&& other
+		) noexcept {
+			std::swap(data, other.data);
+			std::swap(length, other.length);
+		}
+
+		mapping& operator=(
+			mapping&& other
+		) noexcept {
+			std::swap(data, other.data);
+			std::swap(length, other.length);
+
+			return *this;
+		}
+
+		~mapping() {
+			if ( nullptr != data ) {
+				munmap(data, length);
+			}
+		}
+
+		char8_t* begin() const noexcept {
+			return data;
+		}
+
+		mut<usize> size() const noexcept {
+			return length;
+		}
+	};
+
+	void advise(
+		mapping const& memory,
+		int const advice
+	) noexcept {
+		// only hints: a kernel that doesn't know them is no reason to stop
+		if ( 0u != memory.size() ) {
+			madvise(memory.begin(), memory.size(), advice);
+		}
+	}
+
+	// Anonymous memory for the buffers, in huge pages if asked to and if there are any.
+	mapping allocate(
+		usize length,
+		bool const huge_pages
+	) {
+		if ( huge_pages ) {
+			usize huge_length = (length + (usize { 1u } << 21u) - 1u) >> 21u << 21u;
+			void* const address = mmap(nullptr, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			if ( MAP_FAILED != address ) {
+				return mapping(address, huge_length);
+			}
+		}
+
+		void* const address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if ( MAP_FAILED == address ) {
+			fail("mmap");
+		}
+
+		mapping memory(address, length);
+
+#if defined(MADV_HUGEPAGE)
+		if ( huge_pages ) {
+			advise(memory, MADV_HUGEPAGE);
+		}
+#endif
+
+		return memory;
+	}
+
+	class file {
+		mut<int> descriptor;
+		mut<bool> owned;
+
+	public:
+		file(
+			int const descriptor,
+			bool const owned
+		) noexcept : descriptor(descriptor), owned(owned) {
+		}
+
+		file(file const&) = delete;
+		file& operator=(file const&) = delete;
+
+		~file() {
+			if ( owned ) {
+				close(descriptor);
+			}
+		}
+
+		int get() const noexcept {
+			return descriptor;
+		}
+
+		// The size of a regular file, nothing for pipes and the like.
+		std::optional<mut<usize>> regular_size() const {
+			struct stat status;
+
+			if ( 0 != fstat(descriptor, &status) ) {
+				fail("fstat");
+			}
+
+			if ( !S_ISREG(status.st_mode) ) {
+				return std::nullopt;
+			}
+
+			return static_cast<mut<usize>>(status.st_size);
+		}
+	};
+
+	// Where the input comes from: the whole file mapped at once, or read() a chunk at a time.
+	class source {
+		file& input;
+		mapping mapped;
+		mapping buffer;
+		mut<usize> offset = 0u;
+		mut<bool> is_mapped = false;
+
+	public:
+		source(
+			file& input,
+			options const& settings,
+			usize buffer_length
+		) : input(input) {
+			auto const size = input.regular_size();
+
+			// mmap() can't map nothing, an empty file is read() like a pipe
+			if ( size && 0u != *size ) {
+				void* const address = mmap(nullptr, *size, PROT_READ, MAP_PRIVATE, input.get(), 0);
+
+				if ( MAP_FAILED != address ) {
+					mapped = mapping(address, *size);
+					is_mapped = true;
+
+					if ( settings.advise ) {
+						advise(mapped, MADV_SEQUENTIAL);
+						advise(mapped, MADV_WILLNEED);
+					}
+#if defined(MADV_HUGEPAGE)
+					if ( settings.huge_pages ) {
+						advise(mapped, MADV_HUGEPAGE);
+					}
+#endif
+
+					return;
+				}
+			}
+
+			buffer = allocate(buffer_length, settings.huge_pages);
+		}
+
+		// The whole input if it is mapped, its length if that is known.
+		std::optional<mut<usize>> length() const noexcept {
+			if ( is_mapped ) {
+				return mapped.size();
+			}
+
+			return std::nullopt;
+		}
+
+		// The next `length` bytes, fewer only at the end of the input, none after it.
+		u8string_view next(
+			usize length
+		) {
+			if ( is_mapped ) {
+				usize taken = std::min(length, mapped.size() - offset);
+				u8string_view const chunk(mapped.begin() + offset, taken);
+
+				offset += taken;
+
+				return chunk;
+			}
+
+			// a pipe hands out whatever has arrived, so read until the chunk is full
+			mut<usize> filled = 0u;
+			usize wanted = std::min(length, buffer.size());
+
+			while ( filled < wanted ) {
+				ssize_t const got = read(input.get(), buffer.begin() + filled, wanted - filled);
+
+				if ( 0 > got ) {
+					if ( EINTR == errno ) {
+						continue;
+					}
+
+					fail("read");
+				}
+
+				if ( 0 == got ) {
+					break;
+				}
+
+				filled += static_cast<mut<usize>>(got);
+			}
+
+			return u8string_view(buffer.begin(), filled);
+		}
+	};
+
+	void write_all(
+		int const descriptor,
+		u8string_view data
+	) {
+		while ( !data.empty() ) {
+			ssize_t const written = write(descriptor, data.data(), data.size());
+
+			if ( 0 > written ) {
+				if ( EINTR == errno ) {
+					continue;
+				}
+
+				fail("write");
+			}
+
+			data.remove_prefix(static_cast<mut<usize>>(written));
+		}
+	}
+
+	// Where the output goes: straight into a mapping of the output file, grown to `capacity`
+	// bytes up front, or into a buffer of `buffer_length` bytes that is handed to write()
+	// whenever it runs out of room.
+	class sink {
+		file& output;
+		mapping memory;
+		mut<usize> used = 0u;
+		mut<bool> is_mapped = false;
+
+	public:
+		sink(
+			file& output,
+			options const& settings,
+			std::optional<mut<usize>> const capacity,
+			usize buffer_length
+		) : output(output) {
+			if ( settings.mmap_output && capacity ) {
+				if ( 0 != ftruncate(output.get(), static_cast<off_t>(*capacity)) ) {
+					fail("ftruncate " + settings.output);
+				}
+
+				if ( 0u == *capacity ) {
+					is_mapped = true;
+
+					return;
+				}
+
+				void* const address = mmap(nullptr, *capacity, PROT_READ | PROT_WRITE, MAP_SHARED, output.get(), 0);
+
+				if ( MAP_FAILED == address ) {
+					fail("mmap " + settings.output);
+				}
+
+				memory = mapping(address, *capacity);
+				is_mapped = true;
+
+#if defined(MADV_HUGEPAGE)
+				if ( settings.huge_pages ) {
+					advise(memory, MADV_HUGEPAGE);
+				}
+#endif
+
+				return;
+			}
+
+			memory = allocate(buffer_length, settings.huge_pages);
+		}
+
+		// At least `length` bytes to write into, which commit() then keeps.
+		// A mapping already has room for the whole output.
+		std::span<char8_t> room(
+			usize length
+		) {
+			if ( !is_mapped && memory.size() - used < length ) {
+				flush();
+			}
+
+			return std::span<char8_t>(memory.begin() + used, memory.size() - used);
+		}
+
+		void commit(
+			usize length
+		) noexcept {
+			used += length;
+		}
+
+		void flush() {
+			if ( !is_mapped ) {
+				write_all(output.get(), u8string_view(memory.begin(), used));
+				used = 0u;
+			}
+		}
+
+		// Writes out what is left, or cuts the output file down to what was written into it.
+		void finish() {
+			if ( is_mapped ) {
+				memory = mapping();
+
+				if ( 0 != ftruncate(output.get(), static_cast<off_t>(used)) ) {
+					fail("ftruncate");
+				}
+
+				return;
+			}
+
+			flush();
+		}
+	};
+
+	// Whole lines per chunk, so that every chunk but the last ends with a complete line
+	// and is followed by a newline; all lines end with one, as with coreutils.
+	void encode(
+		source& input,
+		sink& output,
+		options const& settings
+	) {
+		usize chunk = step_length(settings);
+
+		for (;;) {
+			u8string_view const data = input.next(chunk);
+
+			if ( data.empty() ) {
+				break;
+			}
+
+			if ( 0u == settings.wrap ) {
+				std::span<char8_t> const room = output.room(encoded_length(data.length()));
+
+				output.commit(base64::encode(data, room));
+			} else {
+				line_format const format(settings.wrap, u8"\n");
+				std::span<char8_t> const room = output.room(encoded_length(data.length(), format) + 1u);
+				usize written = base64::encode(data, format, room);
+
+				room[written] = u8'\n';
+				output.commit(written + 1u);
+			}
+
+			if ( data.length() < chunk ) {
+				break;
+			}
+		}
+	}
+
+	// Decodes the runs between whitespace with one decoder over the whole input, so a group
+	// may be split by a line break or by the end of a chunk. As with coreutils, a padded group
+	// ends one encoding and another may follow it, such as files put together with cat: the
+	// decoder is finished and starts over after it. Empty input decodes to nothing.
+	// Returns false if the input isn't valid base64.
+	bool decode(
+		source& input,
+		sink& output
+	) {
+		base64::decoder decoder;
+		// characters passed to the decoder since it started over, for where its groups end
+		mut<usize> fed = 0u;
+
+		for (;;) {
+			u8string_view const data = input.next(chunk_size);
+
+			if ( data.empty() ) {
+				break;
+			}
+
+			std::span<char8_t> const room = output.room(base64::decoder::max_update_length(data.length()));
+			mut<usize> written = 0u;
+			mut<usize> char_no = 0u;
+
+			while ( char_no < data.length() ) {
+				while ( char_no < data.length() && is_whitespace[data[char_no]] ) {
+					++char_no;
+				}
+
+				usize run_end = char_no + find_whitespace(data.data() + char_no, data.length() - char_no);
+
+				while ( char_no < run_end ) {
+					// up to the '=' that ends a group, if there is one, else the whole run
+					u8string_view const run = data.substr(0u, run_end);
+					mut<usize> end = run_end;
+
+					for (mut<usize> pad = run.find(u8'=', char_no); u8string_view::npos != pad; pad = run.find(u8'=', pad + 1u)) {
+						if ( 0u == (fed + pad + 1u - char_no) % 4u ) {
+							end = pad + 1u;
+
+							break;
+						}
+					}
+
+					auto const decoded = decoder.update(data.substr(char_no, end - char_no), room.subspan(written));
+
+					if ( !decoded ) {
+						return false;
+					}
+
+					written += *decoded;
+					fed += end - char_no;
+					char_no = end;
+
+					if ( u8'=' == data[end - 1u] && 0u == fed % 4u ) {
+						if ( !decoder.finish() ) {
+							return false;
+						}
+
+						fed = 0u;
+					}
+				}
+			}
+
+			output.commit(written);
+
+			if ( data.length() < chunk_size ) {
+				break;
+			}
+		}
+
+		return decoder.finish();
+	}
+
+	[[noreturn]] void usage(
+		char const* const program,
+		int const status
+	) {
+		std::fprintf(0 == status ? stdout : stderr,
+			"usage: %s [-d] [-w COLS] [--mmap-output] [--no-advise] [--huge-pages] [INPUT|- [OUTPUT]]\n"
+			"  -d, --decode     decode instead of encode, ignoring whitespace\n"
+			"  -w, --wrap COLS  break encoded lines after COLS characters, a multiple of 4 (76); 0 for none\n"
+			"  --mmap-output    write into a mapping of OUTPUT instead of with write()\n"
+			"  --no-advise      no madvise(MADV_SEQUENTIAL) on the mapped input\n"
+			"  --huge-pages     ask for huge pages for the buffers and the mappings\n",
+			program);
+		std::exit(status);
+	}
+
+	options parse(
+		int const argc,
+		char** const argv
+	) {
+		options settings;
+		mut<int> positional = 0;
+
+		for (mut<int> i = 1; i < argc; ++i) {
+			std::string_view const argument = argv[i];
+
+			if ( "-d" == argument || "--decode" == argument ) {
+				settings.decode = true;
+			} else if ( "-w" == argument || "--wrap" == argument ) {
+				if ( i + 1 >= argc ) {
+					usage(argv[0], 2);
+				}
+
+				char const* const value = argv[++i];
+				char* end = nullptr;
+
+				errno = 0;
+
+				unsigned long long const columns = std::strtoull(value, &end, 10);
+
+				// strtoull() reads "" as 0 and negates "-4" into a huge count, so only digits will do
+				if ( value == end || !std::isdigit(static_cast<unsigned char>(value[0])) || '\0' != *end || ERANGE == errno ) {
+					std::fprintf(stderr, "%s: invalid wrap size: '%s'\n", argv[0], value);
+					std::exit(2);
+				}
+
+				if ( 0u != columns % 4u ) {
+					std::fprintf(stderr, "%s: --wrap takes a multiple of 4, so that no group is split\n", argv[0]);
+					std::exit(2);
+				}
+
+				settings.wrap = columns;
+			} else if ( "--mmap-output" == argument ) {
+				settings.mmap_output = true;
+			} else if ( "--no-advise" == argument ) {
+				settings.advise = false;
+			} else if ( "--huge-pages" == argument ) {
+				settings.huge_pages = true;
+			} else if ( "-h" == argument || "--help" == argument ) {
+				usage(argv[0], 0);
+			} else if ( argument.starts_with("-") && "-" != argument ) {
+				usage(argv[0], 2);
+			} else if ( 0 == positional ) {
+				settings.input = argument;
+				++positional;
+			} else if ( 1 == positional ) {
+				settings.output = argument;
+				++positional;
+			} else {
+				usage(argv[0], 2);
+			}
+		}
+
+		return settings;
+	}
+
+} // namespace
+
+int main(
+	int const argc,
+	char** const argv
+) {
+	options const settings = parse(argc, argv);
+
+	try {
+		int const input_descriptor = "-" == settings.input ? STDIN_FILENO : open(settings.input.c_str(), O_RDONLY);
+
+		if ( 0 > input_descriptor ) {
+			fail(settings.input);
+		}
+
+		file input(input_descriptor, STDIN_FILENO != input_descriptor);
+
+		// a shared, writable mapping needs the file open for reading as well
+		int const output_descriptor = "-" == settings.output
+			? STDOUT_FILENO
+			: open(settings.output.c_str(), (settings.mmap_output ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC, 0666);
+
+		if ( 0 > output_descriptor ) {
+			fail(settings.output);
+		}
+
+		file output(output_descriptor, STDOUT_FILENO != output_descriptor);
+		usize step = step_length(settings);
+		source reader(input, settings, step);
+
+		// Mapping the output needs to know how big it can get, and a named file to map
+		// (standard output is only open for writing). Otherwise --mmap-output falls back to write().
+		mut<std::optional<mut<usize>>> capacity;
+
+		if ( settings.mmap_output && "-" != settings.output && reader.length() && output.regular_size() ) {
+			usize length = *reader.length();
+
+			if ( settings.decode ) {
+				capacity = max_decoded_length(length);
+			} else if ( 0u == settings.wrap ) {
+				capacity = encoded_length(length);
+			} else {
+				// and the newline after the last line
+				capacity = encoded_length(length, line_format(settings.wrap, u8"\n")) + (0u == length ? 0u : 1u);
+			}
+		}
+
+		// room for what a whole step writes, newlines included, or the whole output if that is less
+		sink writer(output, settings, capacity, step_output_length(settings, std::min(step, reader.length().value_or(step))));
+
+		if ( settings.decode ) {
+			if ( !decode(reader, writer) ) {
+				writer.finish();
+				std::fprintf(stderr, "%s: invalid input\n", argv[0]);
+
+				return 1;
+			}
+		} else {
+			encode(reader, writer, settings);
+		}
+
+		writer.finish();
+	} catch ( std::exception const& error ) {
+		std::fprintf(stderr, "%s: %s\n", argv[0], error.what());
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -37,6 +37,49 @@ Updated by @xxpertHacker
 #include <string>
 #include <type_traits>
 #include <optional>
+#include <array>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <vector>
+#include <thread>
+#include <latch>
+#include <functional>
+#include <concepts>
+#include <ranges>
+#include <utility>
+#include <version>
+
+#if defined(__cpp_lib_expected)
+#include <expected>
+#endif
+
+#if defined(BASE64_INSTRUMENT)
+#include <atomic>
+#include <bit>
+#include <new>
+#endif
+
+// Hand-vectorized kernels are compiled with per-function target attributes,
+// so the header never needs -mavx2 and picks the widest kernel at runtime.
+// #define BASE64_NO_SIMD before including to build only the portable path.
+#if !defined(BASE64_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define BASE64_X86_SIMD 0
+#endif
+
+// #define BASE64_INSTRUMENT before including to count calls, bytes, rejected inputs and input lengths
+// per entry point and kernel in every thread, for base64::instrument::snapshot() to add up.
+
+// #define BASE64_ENCODE_PAIRS before including to have the portable encoder look up
+// 2 characters at a time in a 4096 entry table (8 KiB per alphabet) instead of 1 in the 64 byte alphabet.
+// Half the loads and stores, for an L1 footprint that only pays off when encoding is the hot loop.
 
 namespace base64 {
 
@@ -56,95 +99,696 @@ namespace base64 {
 
 		using usize = std::size_t const;
 
+		using u32 = std::uint32_t const;
+
+		using u64 = std::uint64_t const;
+
+		// Counters for production builds, compiled in with BASE64_INSTRUMENT and free otherwise:
+		// calls, bytes and a log2 histogram of the input lengths, per entry point and per kernel.
+		// Each thread counts into its own block, so counting is a few plain adds without any lock
+		// or atomic read-modify-write; snapshot() sums up all the blocks whenever it is asked to.
+		namespace instrument {
+
+			enum class site : unsigned char {
+				// entry points; the batch ones count every item, the stream ones every update()
+				encode,
+				encode_wrapped,
+				decode,
+				decode_nocheck,
+				try_decode,
+				decode_skip_whitespace,
+				decode_in_place,
+				validate,
+				encode_stream,
+				decode_stream,
+				encode_fragments,
+				decode_fragments,
+				encode_batch,
+				decode_batch,
+				parallel_encode,
+				parallel_decode,
+				// kernels, as the dispatchers picked them
+				encode_scalar,
+				encode_avx2,
+				encode_avx512,
+				encode_lanes_scalar,
+				encode_lanes_avx2,
+				decode_scalar,
+				decode_ssse3,
+				decode_avx2,
+				decode_avx512,
+				validate_scalar,
+				validate_ssse3,
+				validate_avx2,
+				validate_avx512
+			};
+
+			constexpr usize site_count = static_cast<mut<usize>>(site::validate_avx512) + 1u;
+
+			constexpr std::array<std::string_view, site_count> site_names {
+				"encode", "encode_wrapped", "decode", "decode_nocheck", "try_decode",
+				"decode_skip_whitespace", "decode_in_place", "validate",
+				"encode_stream", "decode_stream", "encode_fragments", "decode_fragments",
+				"encode_batch", "decode_batch", "parallel_encode", "parallel_decode",
+				"encode/scalar", "encode/avx2", "encode/avx512", "encode_lanes/scalar", "encode_lanes/avx2",
+				"decode/scalar", "decode/ssse3", "decode/avx2", "decode/avx512",
+				"validate/scalar", "validate/ssse3", "validate/avx2", "validate/avx512"
+			};
+
+			constexpr std::string_view name(
+				site const where
+			) noexcept {
+				return site_names[static_cast<mut<usize>>(where)];
+			}
+
+			// Bucket 0 counts empty inputs, bucket b the lengths from 2^(b - 1) to 2^b - 1.
+			constexpr usize bucket_count = 65u;
+
+#if defined(BASE64_INSTRUMENT)
+			// One thread's counters of one site, on cache lines of their own.
+			// The calls are the sum of the histogram, so they take no counter of their own.
+			struct alignas(64) site_counters {
+				std::atomic<std::uint64_t> bytes;
+				std::atomic<std::uint64_t> rejected;
+				std::atomic<std::uint64_t> sizes[bucket_count];
+			};
+
+			// Blocks are never freed: a thread hands its block back when it exits, with its counts,
+			// and the next new thread carries on counting in it. So the list only grows to the
+			// highest number of threads that ever counted at the same time.
+			struct thread_counters {
+				site_counters sites[site_count] {};
+				std::atomic<bool> in_use { true };
+				thread_counters* next = nullptr;
+			};
+
+			inline std::atomic<thread_counters*> all_threads { nullptr };
+
+			// Shared by the threads that found no memory for a block of their own, which may lose counts.
+			inline thread_counters overflow_counters;
+
+			inline thread_counters& acquire_counters() noexcept {
+				for (mut<thread_counters*> block = all_threads.load(std::memory_order_acquire); nullptr != block; block = block->next) {
+					mut<bool> free = false;
+
+					if ( block->in_use.compare_exchange_strong(free, true, std::memory_order_acquire) ) {
+						return *block;
+					}
+				}
+
+				mut<thread_counters*> block = new (std::nothrow) thread_counters;
+
+				if ( nullptr == block ) {
+					return overflow_counters;
+				}
+
+				block->next = all_threads.load(std::memory_order_relaxed);
+
+				while ( !all_threads.compare_exchange_weak(block->next, block, std::memory_order_release, std::memory_order_relaxed) ) {
+				}
+
+				return *block;
+			}
+
+			// This thread's block. Constant initialized, so reading it is a plain load
+			// rather than a call through the guard of a thread_local with a constructor.
+			inline thread_local thread_counters* current_counters = nullptr;
+
+			// Hands the block back when the thread exits. Whatever is still counted after that,
+			// by destructors of other thread_locals, goes to overflow_counters.
+			struct thread_slot {
+				thread_counters& counters = acquire_counters();
+
+				~thread_slot() {
+					current_counters = &overflow_counters;
+
+					if ( &overflow_counters != &counters ) {
+						counters.in_use.store(false, std::memory_order_release);
+					}
+				}
+			};
+
+			inline thread_counters& first_use() noexcept {
+				thread_local thread_slot slot;
+
+				return slot.counters;
+			}
+
+			inline site_counters& local(
+				site const where
+			) noexcept {
+				if ( nullptr == current_counters ) [[unlikely]] {
+					current_counters = &first_use();
+				}
+
+				return current_counters->sites[static_cast<mut<usize>>(where)];
+			}
+
+			// Only the owning thread ever writes a counter, so a relaxed load and store is all
+			// an increment takes: plain instructions, while snapshot() still reads whole values.
+			inline void add(
+				std::atomic<std::uint64_t>& counter,
+				std::uint64_t const amount
+			) noexcept {
+				counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+			}
+
+			inline void record_call(
+				site const where,
+				usize length
+			) noexcept {
+				site_counters& counters = local(where);
+
+				add(counters.bytes, length);
+				add(counters.sizes[std::bit_width(length)], 1u);
+			}
+
+			inline void record_rejected(
+				site const where
+			) noexcept {
+				add(local(where).rejected, 1u);
+			}
+#endif
+
+			// One call at `where` on `length` bytes (or characters) of input.
+			constexpr void count_call(
+				[[maybe_unused]] site const where,
+				[[maybe_unused]] usize length
+			) noexcept {
+#if defined(BASE64_INSTRUMENT)
+				if ( !std::is_constant_evaluated() ) {
+					record_call(where, length);
+				}
+#endif
+			}
+
+			// ... which turned out not to be valid base64.
+			constexpr void count_rejected(
+				[[maybe_unused]] site const where
+			) noexcept {
+#if defined(BASE64_INSTRUMENT)
+				if ( !std::is_constant_evaluated() ) {
+					record_rejected(where);
+				}
+#endif
+			}
+
+#if defined(BASE64_INSTRUMENT)
+			struct site_statistics {
+				mut<std::uint64_t> calls = 0u;
+				mut<std::uint64_t> bytes = 0u;
+				mut<std::uint64_t> rejected = 0u;
+				std::array<std::uint64_t, bucket_count> sizes {};
+			};
+
+			// Totals of every thread that has counted so far, including the ones that have exited.
+			struct statistics {
+				std::array<site_statistics, site_count> sites {};
+
+				site_statistics const& operator[](
+					site const where
+				) const noexcept {
+					return sites[static_cast<mut<usize>>(where)];
+				}
+
+				// What was counted between two snapshots.
+				friend statistics operator-(
+					statistics difference,
+					statistics const& earlier
+				) noexcept {
+					for (mut<usize> site_no = 0u; site_no < site_count; ++site_no) {
+						site_statistics& later = difference.sites[site_no];
+						site_statistics const& before = earlier.sites[site_no];
+
+						later.calls -= before.calls;
+						later.bytes -= before.bytes;
+						later.rejected -= before.rejected;
+
+						for (mut<usize> bucket = 0u; bucket < bucket_count; ++bucket) {
+							later.sizes[bucket] -= before.sizes[bucket];
+						}
+					}
+
+					return difference;
+				}
+			};
+
+			inline void accumulate(
+				statistics& totals,
+				thread_counters const& block
+			) noexcept {
+				for (mut<usize> site_no = 0u; site_no < site_count; ++site_no) {
+					site_counters const& counters = block.sites[site_no];
+					site_statistics& total = totals.sites[site_no];
+
+					total.bytes += counters.bytes.load(std::memory_order_relaxed);
+					total.rejected += counters.rejected.load(std::memory_order_relaxed);
+
+					for (mut<usize> bucket = 0u; bucket < bucket_count; ++bucket) {
+						std::uint64_t const calls = counters.sizes[bucket].load(std::memory_order_relaxed);
+
+						total.sizes[bucket] += calls;
+						total.calls += calls;
+					}
+				}
+			}
+
+			// Never blocks the counting threads, and may miss the calls they are making meanwhile.
+			inline statistics snapshot() noexcept {
+				statistics totals;
+
+				for (mut<thread_counters const*> block = all_threads.load(std::memory_order_acquire); nullptr != block; block = block->next) {
+					accumulate(totals, *block);
+				}
+
+				accumulate(totals, overflow_counters);
+
+				return totals;
+			}
+#endif
+
+		} // namespace base64::detail::instrument
+
 		constexpr u8 b64[] =
 			u8"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 			"abcdefghijklmnopqrstuvwxyz"
 			"0123456789+/";
 
-		// inversion of b64[]
-		constexpr u8 unb64[0x100] = {
-			['A'] = 0,  ['B'] = 1,  ['C'] = 2,  ['D'] = 3,
-			['E'] = 4,  ['F'] = 5,  ['G'] = 6,  ['H'] = 7,
-			['I'] = 8,  ['J'] = 9,  ['K'] = 10, ['L'] = 11,
-			['M'] = 12, ['N'] = 13, ['O'] = 14, ['P'] = 15,
-			['Q'] = 16, ['R'] = 17, ['S'] = 18, ['T'] = 19,
-			['U'] = 20, ['V'] = 21, ['W'] = 22, ['X'] = 23,
-			['Y'] = 24, ['Z'] = 25, ['a'] = 26, ['b'] = 27,
-			['c'] = 28, ['d'] = 29, ['e'] = 30, ['f'] = 31,
-			['g'] = 32, ['h'] = 33, ['i'] = 34, ['j'] = 35,
-			['k'] = 36, ['l'] = 37, ['m'] = 38, ['n'] = 39,
-			['o'] = 40, ['p'] = 41, ['q'] = 42, ['r'] = 43,
-			['s'] = 44, ['t'] = 45, ['u'] = 46, ['v'] = 47,
-			['w'] = 48, ['x'] = 49, ['y'] = 50, ['z'] = 51,
-			['0'] = 52, ['1'] = 53, ['2'] = 54, ['3'] = 55,
-			['4'] = 56, ['5'] = 57, ['6'] = 58, ['7'] = 59,
-			['8'] = 60, ['9'] = 61, ['+'] = 62, ['/'] = 63
-		};
+		// Alphabet policies: the 64 characters in sextet order, and whether encoded strings
+		// are padded to whole groups of 4 with '='. Unpadded alphabets never write '=' and reject it.
+		// Any type with these two members that passes alphabet_policy can be used as well.
+		namespace alphabet {
+
+			// RFC 4648 section 4
+			struct standard {
+				static constexpr auto& characters = b64;
+				static constexpr bool padded = true;
+			};
+
+			struct standard_unpadded {
+				static constexpr auto& characters = b64;
+				static constexpr bool padded = false;
+			};
+
+			// RFC 4648 section 5, safe in URLs and file names
+			struct url {
+				static constexpr u8 characters[] =
+					u8"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz"
+					"0123456789-_";
+				static constexpr bool padded = true;
+			};
+
+			// JWT / JWS (RFC 7515)
+			struct url_unpadded {
+				static constexpr auto& characters = url::characters;
+				static constexpr bool padded = false;
+			};
+
+			// modified base64 of IMAP mailbox names (RFC 3501 section 5.1.3)
+			struct imap {
+				static constexpr u8 characters[] =
+					u8"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz"
+					"0123456789+,";
+				static constexpr bool padded = false;
+			};
+
+			// salts and hashes of bcrypt ($2b$)
+			struct bcrypt {
+				static constexpr u8 characters[] =
+					u8"./"
+					"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz"
+					"0123456789";
+				static constexpr bool padded = false;
+			};
+
+			// the crypt(3) alphabet; only the characters, with the usual big endian bit order,
+			// the byte shuffling of the individual crypt hash formats is up to the caller
+			struct crypt {
+				static constexpr u8 characters[] =
+					u8"./"
+					"0123456789"
+					"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz";
+				static constexpr bool padded = false;
+			};
+
+		} // namespace base64::detail::alphabet
+
+		// 64 different 7 bit characters, none of them '='.
+		// The vector kernels translate through 128 entry tables, hence 7 bits.
+		constexpr bool is_valid_alphabet(
+			ptr<u8> characters
+		) noexcept {
+			std::array<bool, 0x80> seen {};
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				u8 character = characters[i];
+
+				if ( 0x80u <= character || u8'=' == character || seen[character] ) {
+					return false;
+				}
+
+				seen[character] = true;
+			}
+
+			return true;
+		}
+
+		template<typename Alphabet>
+		concept alphabet_policy = requires {
+			{ Alphabet::characters[0u] } -> std::convertible_to<char8_t>;
+			{ Alphabet::padded } -> std::convertible_to<bool>;
+		} && 64u <= sizeof(Alphabet::characters) && is_valid_alphabet(Alphabet::characters);
+
+		// inversion of `alphabet`: maps each of its 64 characters back to its index,
+		// every other character maps to 0 (the same as an 'A')
+		constexpr std::array<char8_t, 0x100> make_unb64(
+			ptr<u8> alphabet
+		) noexcept {
+			std::array<char8_t, 0x100> table {};
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				table[alphabet[i]] = static_cast<char8_t>(i);
+			}
+
+			return table;
+		}
+
+		// boolean version of make_unb64()
+		// true for every character outside of `alphabet`
+		constexpr std::array<bool, 0x100> make_is_invalid(
+			ptr<u8> alphabet
+		) noexcept {
+			std::array<bool, 0x100> table {};
+
+			for (auto& invalid : table) {
+				invalid = true;
+			}
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				table[alphabet[i]] = false;
+			}
+
+			return table;
+		}
+
+		// All tables are derived from the alphabet at compile time, so they can never disagree with it.
+		template<typename Alphabet>
+		constexpr std::array<char8_t, 0x100> unb64 = make_unb64(Alphabet::characters);
 
-		// boolean version of unb64
 		// Checks the integrity of a base64 string to make sure it is
-		// made up of only characters in the base64 alphabet (array b64)
-		constexpr bool is_invalid_base64_char[0x100] = {
-			[ 0x0 ... 0xFF ] = true,
-			['A'] = false, ['B'] = false, ['C'] = false, ['D'] = false,
-			['E'] = false, ['F'] = false, ['G'] = false, ['H'] = false,
-			['I'] = false, ['J'] = false, ['K'] = false, ['L'] = false,
-			['M'] = false, ['N'] = false, ['O'] = false, ['P'] = false,
-			['Q'] = false, ['R'] = false, ['S'] = false, ['T'] = false,
-			['U'] = false, ['V'] = false, ['W'] = false, ['X'] = false,
-			['Y'] = false, ['Z'] = false, ['a'] = false, ['b'] = false,
-			['c'] = false, ['d'] = false, ['e'] = false, ['f'] = false,
-			['g'] = false, ['h'] = false, ['i'] = false, ['j'] = false,
-			['k'] = false, ['l'] = false, ['m'] = false, ['n'] = false,
-			['o'] = false, ['p'] = false, ['q'] = false, ['r'] = false,
-			['s'] = false, ['t'] = false, ['u'] = false, ['v'] = false,
-			['w'] = false, ['x'] = false, ['y'] = false, ['z'] = false,
-			['0'] = false, ['1'] = false, ['2'] = false, ['3'] = false,
-			['4'] = false, ['5'] = false, ['6'] = false, ['7'] = false,
-			['8'] = false, ['9'] = false, ['+'] = false, ['/'] = false
-		};
+		// made up of only characters in the base64 alphabet (e.g. array b64)
+		template<typename Alphabet>
+		constexpr std::array<bool, 0x100> is_invalid_base64_char = make_is_invalid(Alphabet::characters);
 
-		using opt_ustring = std::optional<u8string>;
+		// unb64[] for 7 bit characters, with 0x80 where is_invalid_base64_char[] is set,
+		// what the vector kernels translate through
+		template<typename Alphabet>
+		alignas(64) constexpr std::array<char8_t, 128> decode_table = [] {
+			std::array<char8_t, 128> table {};
 
-		// Converts binary data of length to base64 characters.
-		u8string _encode(
-			u8string_view const input
-		) {
-			// I look at your data like the stream of unsigned bytes that it is
-			ptr<u8> data = input.data();
-			usize length = input.length();
+			for (auto& sextet : table) {
+				sextet = 0x80u;
+			}
 
-			// 0..2
-			u8 pad = ({
-				usize modulus_length = length % 3u;
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				table[Alphabet::characters[i]] = static_cast<char8_t>(i);
+			}
+
+			return table;
+		}();
 
-				static_cast<u8>(
-					((modulus_length & 1u) << 1u)
-					+ ((modulus_length & 2u) >> 1u)
+		// unb64[] shifted to where each of the 4 characters of a group lands in the group's 24 bits,
+		// so that a group decodes with 4 lookups and 3 ORs. Characters outside the alphabet
+		// set the top byte instead: one test covers the validity of 2 groups,
+		// and the low 24 bits stay 0 (as if it were 'A') for decode_nocheck.
+		template<typename Alphabet>
+		constexpr std::array<std::array<std::uint32_t, 0x100>, 4u> decode_shifted = [] {
+			std::array<std::array<std::uint32_t, 0x100>, 4u> tables {};
+
+			for (mut<usize> position = 0u; position < 4u; ++position) {
+				for (mut<usize> character = 0u; character < 0x100u; ++character) {
+					tables[position][character] = is_invalid_base64_char<Alphabet>[character]
+						? 0xFF000000u
+						: static_cast<std::uint32_t>(unb64<Alphabet>[character]) << (18u - 6u * position);
+				}
+			}
+
+			return tables;
+		}();
+
+#if defined(BASE64_ENCODE_PAIRS)
+		constexpr bool encode_through_pairs = true;
+#else
+		constexpr bool encode_through_pairs = false;
+#endif
+
+		// The characters of every pair of sextets, indexed by the 12 bits they make up together,
+		// the first character in the low byte. Only instantiated with BASE64_ENCODE_PAIRS.
+		template<typename Alphabet>
+		constexpr std::array<std::uint16_t, 0x1000> encode_pairs = [] {
+			std::array<std::uint16_t, 0x1000> pairs {};
+
+			for (mut<usize> index = 0u; index < 0x1000u; ++index) {
+				pairs[index] = static_cast<std::uint16_t>(
+					Alphabet::characters[index >> 6u] | Alphabet::characters[index & 0x3Fu] << 8u
 				);
-				// 2 gives 1 and 1 gives 2, but 0 gives 0.
-			});
-			// Could also do (pad = 3 - modulus_length), but that gives 3 when (modulus_length == 0).
-			// 0 => 0
-			// 1 => 1; pad 2
-			// 2 => 2; pad 1
-			// 3 => 0; no pad
-			// 4 => 1; pad 2
-			// 5 => 2; pad 1
+			}
 
-			u8string return_value = ({
-				usize final_length = 4u * (length + pad) / 3u;
+			return pairs;
+		}();
 
-				u8string(final_length, u8'\0');
-			});
+		// The tables of the SSSE3 / AVX2 kernels are derived from the alphabet as well.
+		// Their tricks need an alphabet made of a few runs of consecutive characters
+		// (all of the predefined ones are); `fits` is false for the others,
+		// which are looked up 16 characters at a time instead.
+
+		// What avx2::encode_lookup() adds to a sextet in each of its 14 ranges:
+		// 0..25 => slot 13, 26..51 => slot 0, 52..63 => slots 1..12.
+		struct encode_ranges {
+			std::array<char8_t, 16> offsets {};
+			mut<bool> fits = true;
+		};
+
+		template<typename Alphabet>
+		constexpr encode_ranges encode_ranges_of = [] {
+			encode_ranges ranges;
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				usize slot = i < 26u ? 13u : i < 52u ? 0u : i - 51u;
+				u8 offset = static_cast<char8_t>(Alphabet::characters[i] - i);
+
+				if ( 0u == i || 26u == i || 52u <= i ) {
+					ranges.offsets[slot] = offset;
+				} else if ( ranges.offsets[slot] != offset ) {
+					// not one run of characters
+					ranges.fits = false;
+				}
+			}
+
+			return ranges;
+		}();
+
+		// Tables of ssse3::decode_lookup(). Characters with the same high nibble share a bit set
+		// of the low nibbles that are valid in that row; every distinct set gets one of 7 bits.
+		// `hi` holds the bit of each row, `lo` every bit whose set lacks that low nibble,
+		// so lo[c & 15] & hi[c >> 4] is non zero exactly for characters outside of the alphabet.
+		// `roll` is what to add to the characters of each row to get their sextets; the few
+		// that don't share the offset of their row are moved to a slot of their own (8 and up)
+		// by adding exception_slots[i] to their high nibble.
+		struct decode_nibbles {
+			std::array<char8_t, 16> lo {};
+			std::array<char8_t, 16> hi {};
+			std::array<char8_t, 16> roll {};
+			std::array<char8_t, 8> exceptions {};
+			std::array<char8_t, 8> exception_slots {};
+			mut<usize> exception_count = 0u;
+			mut<bool> fits = true;
+		};
+
+		template<typename Alphabet>
+		constexpr decode_nibbles decode_nibbles_of = [] {
+			decode_nibbles nibbles;
+			std::array<char8_t, 0x100> const sextets = make_unb64(Alphabet::characters);
+
+			// bit l of row_sets[h] is set if character 0xhl is in the alphabet
+			std::array<mut<unsigned>, 16> row_sets {};
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				row_sets[Alphabet::characters[i] >> 4u] |= 1u << (Alphabet::characters[i] & 0xFu);
+			}
+
+			std::array<mut<unsigned>, 7> class_sets {};
+			mut<usize> classes = 0u;
+
+			for (mut<usize> h = 0u; h < 16u; ++h) {
+				mut<usize> j = 0u;
+
+				while ( j < classes && class_sets[j] != row_sets[h] ) {
+					++j;
+				}
+
+				if ( j == classes ) {
+					if ( class_sets.size() == classes ) {
+						nibbles.fits = false;
+
+						return nibbles;
+					}
+
+					class_sets[classes++] = row_sets[h];
+				}
+
+				nibbles.hi[h] = static_cast<char8_t>(1u << j);
+			}
+
+			for (mut<usize> l = 0u; l < 16u; ++l) {
+				for (mut<usize> j = 0u; j < classes; ++j) {
+					if ( 0u == (class_sets[j] >> l & 1u) ) {
+						nibbles.lo[l] |= static_cast<char8_t>(1u << j);
+					}
+				}
+			}
+
+			for (mut<usize> h = 0u; h < 8u; ++h) {
+				auto const offset = [&](usize l) -> char8_t {
+					return static_cast<char8_t>(sextets[h << 4u | l] - (h << 4u | l));
+				};
+
+				// the offset most characters of the row share
+				mut<usize> most = 0u;
+
+				for (mut<usize> l = 0u; l < 16u; ++l) {
+					mut<usize> count = 0u;
+
+					for (mut<usize> k = 0u; k < 16u; ++k) {
+						count += (row_sets[h] >> l & 1u) & (row_sets[h] >> k & 1u) & (offset(l) == offset(k));
+					}
+
+					if ( count > most ) {
+						most = count;
+						nibbles.roll[h] = offset(l);
+					}
+				}
+
+				for (mut<usize> l = 0u; l < 16u; ++l) {
+					if ( 0u == (row_sets[h] >> l & 1u) || nibbles.roll[h] == offset(l) ) {
+						continue;
+					}
+
+					if ( nibbles.exceptions.size() == nibbles.exception_count ) {
+						nibbles.fits = false;
+
+						return nibbles;
+					}
+
+					usize slot = 8u + nibbles.exception_count;
+
+					nibbles.exceptions[nibbles.exception_count] = static_cast<char8_t>(h << 4u | l);
+					nibbles.exception_slots[nibbles.exception_count] = static_cast<char8_t>(slot - h);
+					nibbles.roll[slot] = offset(l);
+					++nibbles.exception_count;
+				}
+			}
+
+			return nibbles;
+		}();
+
+		// Bit i is set if the alphabet has characters in 0x10 * i .. 0x10 * i + 15.
+		template<typename Alphabet>
+		constexpr mut<unsigned> alphabet_rows = [] {
+			mut<unsigned> rows = 0u;
+
+			for (mut<usize> i = 0u; i < 64u; ++i) {
+				rows |= 1u << (Alphabet::characters[i] >> 4u);
+			}
+
+			return rows;
+		}();
+
+		using opt_ustring = std::optional<u8string>;
+
+		// 8 octets as one integer, the first one on top (big endian) or at the bottom (little endian).
+		// Assembled byte by byte so that they work in constant expressions too,
+		// GCC and Clang still turn them into a single load (plus a bswap).
+		constexpr std::uint64_t load_big_endian(
+			ptr<u8> data
+		) noexcept {
+			return static_cast<std::uint64_t>(data[0u]) << 56u | static_cast<std::uint64_t>(data[1u]) << 48u
+				| static_cast<std::uint64_t>(data[2u]) << 40u | static_cast<std::uint64_t>(data[3u]) << 32u
+				| static_cast<std::uint64_t>(data[4u]) << 24u | static_cast<std::uint64_t>(data[5u]) << 16u
+				| static_cast<std::uint64_t>(data[6u]) << 8u | static_cast<std::uint64_t>(data[7u]);
+		}
+
+		constexpr std::uint64_t load_little_endian(
+			ptr<u8> data
+		) noexcept {
+			return static_cast<std::uint64_t>(data[0u]) | static_cast<std::uint64_t>(data[1u]) << 8u
+				| static_cast<std::uint64_t>(data[2u]) << 16u | static_cast<std::uint64_t>(data[3u]) << 24u
+				| static_cast<std::uint64_t>(data[4u]) << 32u | static_cast<std::uint64_t>(data[5u]) << 40u
+				| static_cast<std::uint64_t>(data[6u]) << 48u | static_cast<std::uint64_t>(data[7u]) << 56u;
+		}
 
-			ptr<char8_t> res = return_value.data();
+		// The other way around, the lowest byte goes first. GCC and Clang merge it into one store.
+		constexpr void store_little_endian(
+			ptr<char8_t> res,
+			u64 value
+		) noexcept {
+			res[0u] = static_cast<char8_t>(value);
+			res[1u] = static_cast<char8_t>(value >> 8u);
+			res[2u] = static_cast<char8_t>(value >> 16u);
+			res[3u] = static_cast<char8_t>(value >> 24u);
+			res[4u] = static_cast<char8_t>(value >> 32u);
+			res[5u] = static_cast<char8_t>(value >> 40u);
+			res[6u] = static_cast<char8_t>(value >> 48u);
+			res[7u] = static_cast<char8_t>(value >> 56u);
+		}
 
+		// Converts every complete 3 octet group of data into 4 base64 characters.
+		// Returns how many input bytes were consumed (always a multiple of 3),
+		// the caller deals with the 1 or 2 leftover bytes and the padding.
+		template<typename Alphabet>
+		constexpr mut<usize> encode_groups_scalar(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
 			// Counters
 			mut<usize> result_counter = 0u;
-			mut<usize> byte_no = 0u; // I need this after the loop
+			mut<usize> byte_no = 0u;
+
+			// 2 groups per iteration out of one 64 bit load, whose top 48 bits are 8 sextets in a row.
+			// The 2 octets below them belong to the next iteration, but are read all the same,
+			// so stop while there are still 8 to read; the loop after this one does the rest.
+			for (; byte_no + 8u <= length; byte_no += 6u, result_counter += 8u) {
+				u64 octets = load_big_endian(data + byte_no);
+
+				if constexpr ( encode_through_pairs ) {
+					auto const& pairs = encode_pairs<Alphabet>;
+
+					store_little_endian(
+						res + result_counter,
+						static_cast<std::uint64_t>(pairs[octets >> 52u])
+							| static_cast<std::uint64_t>(pairs[(octets >> 40u) & 0xFFFu]) << 16u
+							| static_cast<std::uint64_t>(pairs[(octets >> 28u) & 0xFFFu]) << 32u
+							| static_cast<std::uint64_t>(pairs[(octets >> 16u) & 0xFFFu]) << 48u
+					);
+				} else {
+					// 8 characters gathered into one register, so they go out in a single store as well
+					auto const character = [&](unsigned const shift) noexcept {
+						return static_cast<std::uint64_t>(Alphabet::characters[(octets >> shift) & 0x3Fu]);
+					};
+
+					store_little_endian(
+						res + result_counter,
+						character(58u) | character(52u) << 8u | character(46u) << 16u | character(40u) << 24u
+							| character(34u) << 32u | character(28u) << 40u | character(22u) << 48u | character(16u) << 56u
+					);
+				}
+			}
 
-			// If there WAS padding, skip the last 3 octets and process below.
 			// iterations for length: 0 => 0x, 1 => 0x, 2 => 0x, 3 => 1x, 4 => 1x, 5 => 1x, 6 => 2x, ...
 			// be careful about unsigned overflow, don't subtract from length or it'll wrap around if (length < 3)
 			for (; byte_no + 3u <= length; byte_no += 3u ) {
@@ -156,154 +800,798 @@ namespace base64 {
 
 				// Take first sextet (an octet (byte) is 8 bits, so a sextet is 6 bits, or a nibble and a half.)
 				// and find out what number they are.
-				res[result_counter++] = b64[byte0 >> 2u];
-				// unsigned so 0's always come in from left (even though there is 
+				res[result_counter++] = Alphabet::characters[byte0 >> 2u];
+				// unsigned so 0's always come in from left (even though there is
 				// implicit int promotion on R&L sides prior to actual bitshift).
 				// convert that number into the base64 alphabet.
 				// the value in 6 bits can never be larger than 63.
 
 				// the second sextet is part of the first byte and partly in the 2nd byte.
-				res[result_counter++] = b64[((0x3u & byte0) << 4u) + (byte1 >> 4u)];
+				res[result_counter++] = Alphabet::characters[((0x3u & byte0) << 4u) + (byte1 >> 4u)];
 
 				// notice how I avoided the scary endian ghost by using an unsigned byte pointer for all this.
 
 				// 3rd sextet is lower nibble of 2nd byte and upper half nibble of 3rd byte.
-				res[result_counter++] = b64[((0x0Fu & byte1) << 2u) + (byte2 >> 6u)];
+				res[result_counter++] = Alphabet::characters[((0x0Fu & byte1) << 2u) + (byte2 >> 6u)];
 
 				// 4th sextet
-				res[result_counter++] = b64[0x3Fu & byte2];
+				res[result_counter++] = Alphabet::characters[0x3Fu & byte2];
 			}
 
-			// The last 3 octets must be converted carefully as if len % 3 == 1 or len % 3 == 2 we must
-			// "pretend" there are additional bits at the end.
-			if ( 2u == pad ) {
-				u8 temp = data[byte_no];
+			return byte_no;
+		}
 
-				// We are missing 2 bytes. So
-				// - we will only extract 2 sextets when (length % 3 == 1)
+#if BASE64_X86_SIMD
+		namespace avx2 {
 
-				res[result_counter++] = b64[temp >> 2u];
-				res[result_counter++] = b64[(0x3u & temp) << 4u];
-				// "padded" by 0's, these 2 bits are still HI ORDER BITS.
-				// Last 2 are ==, to indicate there's been a 2 byte-pad
-				res[result_counter++] = u8'=';
-				res[result_counter++] = u8'=';
-			} else if ( 1u == pad ) {
-				u8 temp0 = data[byte_no];
-				u8 temp1 = data[byte_no + 1u];
+			// 16 table entries, in both 128 bit lanes.
+			__attribute__((target("avx2")))
+			inline __m256i broadcast_row(
+				ptr<u8> row
+			) noexcept {
+				return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(row)));
+			}
 
-				// When (length % 3 == 2) (2, 5, 8, 11) (missing 1 byte).
-				// - 3 sextets
+			// Maps 32 sextets (0..63) onto the alphabet without a table:
+			// every character range of the alphabet is its sextet plus a constant,
+			// so we classify each sextet into one of 14 ranges and add that range's offset.
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline __m256i encode_lookup(
+				__m256i const sextets
+			) noexcept {
+				// 0..25 => 13 ('A'), 26..51 => 0 ('a'), 52..61 => 1..10 ('0'), 62 => 11 ('+'), 63 => 12 ('/')
+				__m256i const reduced = _mm256_or_si256(
+					_mm256_subs_epu8(sextets, _mm256_set1_epi8(51)),
+					_mm256_and_si256(
+						_mm256_cmpgt_epi8(_mm256_set1_epi8(26), sextets),
+						_mm256_set1_epi8(13)
+					)
+				);
 
-				res[result_counter++] = b64[temp0 >> 2u];
-				res[result_counter++] = b64[((0x3u & temp0) << 4u) + (temp1 >> 4u)]; // sex2 formula
-				res[result_counter++] = b64[(0x0Fu & temp1) << 2u]; // only part of SEX3 that comes from byte#1
-				res[result_counter++] = u8'=';
+				// for b64[]: 'a' - 26, '0' - 52 (10 times), '+' - 62, '/' - 63, 'A'
+				__m256i const offsets = broadcast_row(encode_ranges_of<Alphabet>.offsets.data());
+
+				return _mm256_add_epi8(sextets, _mm256_shuffle_epi8(offsets, reduced));
 			}
 
-			return return_value;
-		}
+			// Alphabets that don't fit encode_lookup(): each quarter of it is one 16 entry vpshufb table,
+			// bits 4 and 5 of the sextet pick the quarter.
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline __m256i encode_lookup_rows(
+				__m256i const sextets
+			) noexcept {
+				// vpshufb only looks at the low nibble, vpblendvb only at the top bit
+				__m256i const bit4 = _mm256_slli_epi16(sextets, 3);
+				__m256i const bit5 = _mm256_slli_epi16(sextets, 2);
 
-		bool base64_integrity(
-			u8string_view const potentially_invalid_base64
-		) {
-			ptr<u8> ascii = potentially_invalid_base64.data();
-			usize length = potentially_invalid_base64.length();
+				__m256i const lower = _mm256_blendv_epi8(
+					_mm256_shuffle_epi8(broadcast_row(Alphabet::characters + 0u), sextets),
+					_mm256_shuffle_epi8(broadcast_row(Alphabet::characters + 16u), sextets),
+					bit4
+				);
+				__m256i const upper = _mm256_blendv_epi8(
+					_mm256_shuffle_epi8(broadcast_row(Alphabet::characters + 32u), sextets),
+					_mm256_shuffle_epi8(broadcast_row(Alphabet::characters + 48u), sextets),
+					bit4
+				);
 
-			// looking for bad characters
-			mut<usize> i = 0u; // used after loop
+				return _mm256_blendv_epi8(lower, upper, bit5);
+			}
 
-			for (; 2u + i < length; ++i) {
-				if ( is_invalid_base64_char[ascii[i]] )  {
-					// String is not valid base64
-					return false;
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline __m256i encode_characters(
+				__m256i const sextets
+			) noexcept {
+				if constexpr ( encode_ranges_of<Alphabet>.fits ) {
+					return encode_lookup<Alphabet>(sextets);
+				} else {
+					return encode_lookup_rows<Alphabet>(sextets);
 				}
 			}
 
-			// Only last 2 can be '='
-			// Check 2nd last:
-			// If the 2nd last is = the last MUST be = too
-			if ( u8'=' == ascii[i] ) {
-				if ( u8'=' != ascii[1u + i] ) {
-					return false;
-				}
-			} else if ( is_invalid_base64_char[ascii[i]] ) {
-				// not '=' or valid base64
-				// 2nd last was invalid and not '='
-				return false;
+			// Splits each 32 bit lane holding bytes [b1, b0, b2, b1] of one
+			// 3 octet group into the 4 sextets of that group, one per byte.
+			__attribute__((target("avx2")))
+			inline __m256i encode_split(
+				__m256i const groups
+			) noexcept {
+				// sextets 0 and 2: shift right by 10 and 6 with a high multiply
+				__m256i const ac = _mm256_mulhi_epu16(
+					_mm256_and_si256(groups, _mm256_set1_epi32(0x0FC0FC00)),
+					_mm256_set1_epi32(0x04000040)
+				);
+
+				// sextets 1 and 3: shift left by 8 and 4 with a low multiply
+				__m256i const bd = _mm256_mullo_epi16(
+					_mm256_and_si256(groups, _mm256_set1_epi32(0x003F03F0)),
+					_mm256_set1_epi32(0x01000010)
+				);
+
+				return _mm256_or_si256(ac, bd);
 			}
 
-			// check last
-			auto const last_character = ascii[1u + i];
+			// 24 input bytes => 32 base64 characters per iteration.
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline mut<usize> encode_groups(
+				ptr<u8> data,
+				usize length,
+				ptr<char8_t> res
+			) noexcept {
+				// Each lane gets 12 input bytes, spread over 16 bytes in [b1, b0, b2, b1] order.
+				__m256i const spread = _mm256_setr_epi8(
+					1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+					1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+				);
 
-			return !( u8'=' != last_character && is_invalid_base64_char[last_character] );
-			// (last char) string is not valid base64; Otherwise base64 string was valid.
-		}
+				mut<usize> byte_no = 0u;
+				mut<usize> result_counter = 0u;
 
-		template<bool const check_validity>
-		opt_ustring _decode(
-			u8string_view const input
-		) {
-			if constexpr (check_validity) {
-				if ( false == base64_integrity( input ) ) {
-					// bad integrity.
-					return opt_ustring { std::nullopt };
+				// The upper 16 byte load starts at +12 and reads up to +28,
+				// 4 bytes beyond what this iteration consumes, so leave room for it.
+				for (; byte_no + 28u <= length; byte_no += 24u, result_counter += 32u) {
+					auto const temp = data + byte_no;
+
+					__m256i const input = _mm256_inserti128_si256(
+						_mm256_castsi128_si256(
+							_mm_loadu_si128(reinterpret_cast<__m128i const*>(temp))
+						),
+						_mm_loadu_si128(reinterpret_cast<__m128i const*>(temp + 12u)),
+						1
+					);
+
+					__m256i const sextets = encode_split(_mm256_shuffle_epi8(input, spread));
+
+					_mm256_storeu_si256(
+						reinterpret_cast<__m256i*>(res + result_counter),
+						encode_characters<Alphabet>(sextets)
+					);
 				}
+
+				return byte_no + encode_groups_scalar<Alphabet>(data + byte_no, length - byte_no, res + result_counter);
 			}
 
-			ptr<u8> data = input.data();
-			// the maximum value read out is 255,
-			// and the value is never negative. This is a type of
-			// "if statement" enforced by the type of the pointer.
-			// This eliminates a possible bounds check on array lookups into unb64[]
-			// (having values between 0 and 255 means it will always be
-			// inside the bounds of the 256 element array).
-			usize length = input.length();
+			// Multi-buffer mode for inputs too short to ever reach the loop above:
+			// 8 independent inputs share one register, lane i encodes group g of input i.
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline void encode_lanes(
+				ptr<u8* const> data,
+				ptr<char8_t* const> res,
+				usize groups
+			) noexcept {
+				// [b0, b1, b2, 0] => [b1, b0, b2, b1] in every lane
+				__m256i const spread = _mm256_setr_epi8(
+					1, 0, 2, 1, 5, 4, 6, 5, 9, 8, 10, 9, 13, 12, 14, 13,
+					1, 0, 2, 1, 5, 4, 6, 5, 9, 8, 10, 9, 13, 12, 14, 13
+				);
 
-			if ( length < 2u ) {
-				// 2 accesses below would be OOB.
-				// catch empty string, return nullopt as result.
-				// you passed an invalid base64 string (too short)
-				return opt_ustring {
-					std::nullopt
+				// Every group but the last is followed by at least one more byte of its input,
+				// so it can be read with a single 4 byte load; the 4th byte is shuffled away.
+				auto const group = [&](usize lane, usize byte_no) noexcept -> int {
+					mut<int> word;
+
+					std::memcpy(&word, data[lane] + byte_no, 4u);
+
+					return word;
 				};
-			}
 
-			// Count == on the end to determine how much it was padded.
-			// 0..2
-			u8 pad = static_cast<u8>(u8'=' == data[length - 1u])
-				   + static_cast<u8>(u8'=' == data[length - 2u]);
+				auto const last_group = [&](usize lane, usize byte_no) noexcept -> int {
+					auto const temp = data[lane] + byte_no;
 
-			u8string return_value = ({
-				// You take the ascii string len and divide it by 4
-				// to get #24lets (groups of 3 octets). You then * 3 to
-				// get #octets total.
-				usize final_length = length / 4u * 3u - pad;
+					return static_cast<int>(temp[0u] | (temp[1u] << 8u) | (temp[2u] << 16u));
+				};
 
-				u8string(final_length, u8'\0');
-			});
+				alignas(32) mut<char8_t> characters[32u];
 
-			ptr<char8_t> res = return_value.data();
+				for (mut<usize> group_no = 0u; group_no < groups; ++group_no) {
+					usize byte_no = 3u * group_no;
+					__m256i input;
 
-			mut<usize> counter = 0u; // counter for `data`
-			mut<usize> char_no = 0u; // counter for what base64 char we're currently decoding
+					if ( group_no + 1u < groups ) {
+						input = _mm256_setr_epi32(
+							group(0u, byte_no), group(1u, byte_no), group(2u, byte_no), group(3u, byte_no),
+							group(4u, byte_no), group(5u, byte_no), group(6u, byte_no), group(7u, byte_no)
+						);
+					} else {
+						input = _mm256_setr_epi32(
+							last_group(0u, byte_no), last_group(1u, byte_no), last_group(2u, byte_no), last_group(3u, byte_no),
+							last_group(4u, byte_no), last_group(5u, byte_no), last_group(6u, byte_no), last_group(7u, byte_no)
+						);
+					}
 
-			// NEVER do the last group of 4 characters if either of the
-			// last 2 chars were pad.
-			for (; char_no + (4u + pad) <= length; char_no += 4u ) {
-				auto const temp = data + char_no;
+					_mm256_store_si256(
+						reinterpret_cast<__m256i*>(characters),
+						encode_characters<Alphabet>(encode_split(_mm256_shuffle_epi8(input, spread)))
+					);
 
-				// Get the numbers each character represents
-				// Since ascii is ONE BYTE, the worst that can happen is
+					for (mut<usize> lane = 0u; lane < 8u; ++lane) {
+						std::memcpy(res[lane] + 4u * group_no, characters + 4u * lane, 4u);
+					}
+				}
+			}
+
+		} // namespace base64::detail::avx2
+
+		namespace avx512 {
+
+			// The unmasked vpermb / vpmultishiftqb intrinsics pass an undefined vector through,
+			// which GCC 12 reports as maybe-uninitialized; their zero masked forms with every lane set don't.
+			constexpr __mmask64 every_byte = ~__mmask64 { 0u };
+
+			// Byte permutations are built once, at compile time, from the group layout.
+
+			// input byte of every output byte, 16 groups as [b1, b0, b2, b1]
+			alignas(64) constexpr std::array<char8_t, 64> encode_spread = [] {
+				std::array<char8_t, 64> spread {};
+
+				for (mut<usize> group = 0u; group < 16u; ++group) {
+					spread[4u * group + 0u] = static_cast<char8_t>(3u * group + 1u);
+					spread[4u * group + 1u] = static_cast<char8_t>(3u * group + 0u);
+					spread[4u * group + 2u] = static_cast<char8_t>(3u * group + 2u);
+					spread[4u * group + 3u] = static_cast<char8_t>(3u * group + 1u);
+				}
+
+				return spread;
+			}();
+
+			// 48 input bytes => 64 base64 characters per iteration.
+			// vpmultishiftqb pulls each sextet out of its group with one instruction,
+			// and vpermb looks all 64 of them up in the alphabet with another, whichever it is.
+			template<typename Alphabet>
+			__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+			inline mut<usize> encode_groups(
+				ptr<u8> data,
+				usize length,
+				ptr<char8_t> res
+			) noexcept {
+				__m512i const spread = _mm512_load_si512(encode_spread.data());
+				__m512i const alphabet = _mm512_loadu_si512(Alphabet::characters);
+				// bit offsets of sextets 0..3 inside [b1, b0, b2, b1], for both groups of a qword
+				__m512i const shifts = _mm512_set1_epi64(0x3036242A1016040A);
+
+				mut<usize> byte_no = 0u;
+				mut<usize> result_counter = 0u;
+
+				for (; byte_no + 48u <= length; byte_no += 48u, result_counter += 64u) {
+					// masked off bytes are never touched, so reading 48 of 64 cannot fault
+					__m512i const input = _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFFull, data + byte_no);
+
+					__m512i const sextets = _mm512_maskz_multishift_epi64_epi8(
+						every_byte,
+						shifts,
+						_mm512_maskz_permutexvar_epi8(every_byte, spread, input)
+					);
+
+					_mm512_storeu_si512(res + result_counter, _mm512_maskz_permutexvar_epi8(every_byte, sextets, alphabet));
+				}
+
+				return byte_no + avx2::encode_groups<Alphabet>(data + byte_no, length - byte_no, res + result_counter);
+			}
+
+		} // namespace base64::detail::avx512
+#endif
+
+		using encode_kernel = mut<usize> (*)(ptr<u8>, usize, ptr<char8_t>) noexcept;
+
+		// Picks the widest kernel this CPU can run.
+		template<typename Alphabet>
+		inline encode_kernel select_encode_kernel() noexcept {
+#if BASE64_X86_SIMD
+			__builtin_cpu_init();
+
+			if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+				return avx512::encode_groups<Alphabet>;
+			}
+
+			if ( __builtin_cpu_supports("avx2") ) {
+				return avx2::encode_groups<Alphabet>;
+			}
+#endif
+			return encode_groups_scalar<Alphabet>;
+		}
+
+#if defined(BASE64_INSTRUMENT)
+		template<typename Alphabet>
+		inline instrument::site encode_kernel_site(
+			encode_kernel const kernel
+		) noexcept {
+#if BASE64_X86_SIMD
+			if ( avx512::encode_groups<Alphabet> == kernel ) {
+				return instrument::site::encode_avx512;
+			}
+
+			if ( avx2::encode_groups<Alphabet> == kernel ) {
+				return instrument::site::encode_avx2;
+			}
+#endif
+			return instrument::site::encode_scalar;
+		}
+#endif
+
+		// Same contract as encode_groups_scalar(), CPUID is only consulted on the first call.
+		template<typename Alphabet>
+		inline mut<usize> encode_groups_dispatched(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
+			static encode_kernel const kernel = select_encode_kernel<Alphabet>();
+
+#if defined(BASE64_INSTRUMENT)
+			static instrument::site const where = encode_kernel_site<Alphabet>(kernel);
+
+			instrument::count_call(where, length);
+#endif
+
+			return kernel(data, length, res);
+		}
+
+		// Constant evaluation can neither ask the CPU nor run intrinsics, so it takes the scalar loop.
+		template<typename Alphabet>
+		constexpr mut<usize> encode_groups(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
+			if ( std::is_constant_evaluated() ) {
+				return encode_groups_scalar<Alphabet>(data, length, res);
+			}
+
+			return encode_groups_dispatched<Alphabet>(data, length, res);
+		}
+
+		// How many inputs encode_lanes() takes at once.
+		constexpr usize lane_count = 8u;
+
+		// Encodes the first `groups` complete groups of each of lane_count inputs,
+		// every one of which must have at least that many.
+		template<typename Alphabet>
+		inline void encode_lanes_scalar(
+			ptr<u8* const> data,
+			ptr<char8_t* const> res,
+			usize groups
+		) noexcept {
+			for (mut<usize> lane = 0u; lane < lane_count; ++lane) {
+				encode_groups_scalar<Alphabet>(data[lane], 3u * groups, res[lane]);
+			}
+		}
+
+		using encode_lanes_kernel = void (*)(ptr<u8* const>, ptr<char8_t* const>, usize) noexcept;
+
+		template<typename Alphabet>
+		inline encode_lanes_kernel select_encode_lanes_kernel() noexcept {
+#if BASE64_X86_SIMD
+			__builtin_cpu_init();
+
+			if ( __builtin_cpu_supports("avx2") ) {
+				return avx2::encode_lanes<Alphabet>;
+			}
+#endif
+			return encode_lanes_scalar<Alphabet>;
+		}
+
+		template<typename Alphabet>
+		inline void encode_lanes(
+			ptr<u8* const> data,
+			ptr<char8_t* const> res,
+			usize groups
+		) noexcept {
+			static encode_lanes_kernel const kernel = select_encode_lanes_kernel<Alphabet>();
+
+#if defined(BASE64_INSTRUMENT)
+			static instrument::site const where = encode_lanes_scalar<Alphabet> == kernel
+				? instrument::site::encode_lanes_scalar
+				: instrument::site::encode_lanes_avx2;
+
+			instrument::count_call(where, lane_count * 3u * groups);
+#endif
+
+			kernel(data, res, groups);
+		}
+
+		// 4 characters for every started group of 3 octets, padding included;
+		// without padding the last group only takes the 2 or 3 characters it needs.
+		template<typename Alphabet = alphabet::standard>
+		constexpr mut<usize> encoded_length(
+			usize length
+		) noexcept {
+			if constexpr ( Alphabet::padded ) {
+				return (length + 2u) / 3u * 4u;
+			} else {
+				return (length * 4u + 2u) / 3u;
+			}
+		}
+
+		// Upper bound on what `length` base64 characters decode to, with or without padding;
+		// the exact amount depends on how many '=' they end with.
+		constexpr mut<usize> max_decoded_length(
+			usize length
+		) noexcept {
+			return length / 4u * 3u + length % 4u * 3u / 4u;
+		}
+
+		// Encodes the 1 or 2 octets behind the last complete group, `pad` says which (2 or 1).
+		// Unpadded alphabets leave out the '=', so only 2 or 3 characters are written.
+		template<typename Alphabet>
+		constexpr void encode_last_group(
+			ptr<u8> data,
+			usize pad,
+			ptr<char8_t> res
+		) noexcept {
+			mut<usize> result_counter = 0u;
+
+			// The last 3 octets must be converted carefully as if len % 3 == 1 or len % 3 == 2 we must
+			// "pretend" there are additional bits at the end.
+			if ( 2u == pad ) {
+				u8 temp = data[0u];
+
+				// We are missing 2 bytes. So
+				// - we will only extract 2 sextets when (length % 3 == 1)
+
+				res[result_counter++] = Alphabet::characters[temp >> 2u];
+				res[result_counter++] = Alphabet::characters[(0x3u & temp) << 4u];
+				// "padded" by 0's, these 2 bits are still HI ORDER BITS.
+				// Last 2 are ==, to indicate there's been a 2 byte-pad
+				if constexpr ( Alphabet::padded ) {
+					res[result_counter++] = u8'=';
+					res[result_counter++] = u8'=';
+				}
+			} else if ( 1u == pad ) {
+				u8 temp0 = data[0u];
+				u8 temp1 = data[1u];
+
+				// When (length % 3 == 2) (2, 5, 8, 11) (missing 1 byte).
+				// - 3 sextets
+
+				res[result_counter++] = Alphabet::characters[temp0 >> 2u];
+				res[result_counter++] = Alphabet::characters[((0x3u & temp0) << 4u) + (temp1 >> 4u)]; // sex2 formula
+				res[result_counter++] = Alphabet::characters[(0x0Fu & temp1) << 2u]; // only part of SEX3 that comes from byte#1
+
+				if constexpr ( Alphabet::padded ) {
+					res[result_counter++] = u8'=';
+				}
+			}
+		}
+
+		// Converts binary data of length to base64 characters.
+		// `res` must have room for encoded_length<Alphabet>(input.length()) characters.
+		template<typename Alphabet>
+		constexpr void _encode_into(
+			u8string_view const input,
+			ptr<char8_t> res
+		) noexcept {
+			// I look at your data like the stream of unsigned bytes that it is
+			ptr<u8> data = input.data();
+			usize length = input.length();
+
+			// 0..2
+			usize modulus_length = length % 3u;
+			usize pad = ((modulus_length & 1u) << 1u) + ((modulus_length & 2u) >> 1u);
+			// 2 gives 1 and 1 gives 2, but 0 gives 0.
+			// Could also do (pad = 3 - modulus_length), but that gives 3 when (modulus_length == 0).
+			// 0 => 0
+			// 1 => 1; pad 2
+			// 2 => 2; pad 1
+			// 3 => 0; no pad
+			// 4 => 1; pad 2
+			// 5 => 2; pad 1
+
+			// If there WAS padding, skip the last 3 octets and process below.
+			mut<usize> byte_no = encode_groups<Alphabet>(data, length, res); // I need this after the loop
+			usize result_counter = byte_no / 3u * 4u;
+
+			encode_last_group<Alphabet>(data + byte_no, pad, res + result_counter);
+		}
+
+		// Grows `string` by up to `count` characters and hands the new tail to `write`,
+		// which returns how many of them it used; the rest are dropped again.
+		// With C++23 the tail is never zero-filled first, so every character is written once.
+		// `write` then runs inside resize_and_overwrite(), where an exception is undefined behavior
+		// (libstdc++ leaves the string empty, losing what it held), so it has to be noexcept.
+		template<typename Write>
+		constexpr void append_uninitialized(
+			u8string& string,
+			usize count,
+			Write&& write
+		) {
+			static_assert( std::is_nothrow_invocable_v<Write&, char8_t*>, "use append_uninitialized_rethrow() for a `write` that may throw" );
+
+			usize old_length = string.length();
+
+#if defined(__cpp_lib_string_resize_and_overwrite)
+			// resize_and_overwrite() reserves geometrically, so repeated appends stay amortized O(1)
+			string.resize_and_overwrite(old_length + count, [&](ptr<char8_t> data, usize) -> mut<usize> {
+				return old_length + write(data + old_length);
+			});
+#else
+			string.resize(old_length + count);
+			string.resize(old_length + write(string.data() + old_length));
+#endif
+		}
+
+		// Same, for a `write` that may throw, such as one that iterates ranges of the caller or
+		// runs tasks on other threads: the exception is caught before it gets to resize_and_overwrite()
+		// and passed on once `string` is back to what it was.
+		template<typename Write>
+		inline void append_uninitialized_rethrow(
+			u8string& string,
+			usize count,
+			Write&& write
+		) {
+			std::exception_ptr error;
+
+			append_uninitialized(string, count, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				try {
+					return write(res);
+				} catch (...) {
+					error = std::current_exception();
+
+					return 0u;
+				}
+			});
+
+			if ( error ) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		template<typename Alphabet>
+		constexpr mut<usize> _append_encode(
+			u8string& output,
+			u8string_view const input
+		) {
+			usize final_length = encoded_length<Alphabet>(input.length());
+
+			instrument::count_call(instrument::site::encode, input.length());
+
+			append_uninitialized(output, final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				_encode_into<Alphabet>(input, res);
+
+				return final_length;
+			});
+
+			return final_length;
+		}
+
+		template<typename Alphabet>
+		constexpr u8string _encode(
+			u8string_view const input
+		) {
+			u8string return_value;
+
+			_append_encode<Alphabet>(return_value, input);
+
+			return return_value;
+		}
+
+		template<typename Alphabet>
+		constexpr mut<usize> _encode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			usize final_length = encoded_length<Alphabet>(input.length());
+
+			if ( output.size() < final_length ) {
+				throw std::length_error("base64::encode: output is shorter than encoded_length()");
+			}
+
+			instrument::count_call(instrument::site::encode, input.length());
+
+			_encode_into<Alphabet>(input, output.data());
+
+			return final_length;
+		}
+
+		// Where encoded lines are broken and with what. `width` counts characters without the newline,
+		// and has to be a multiple of 4 so that no group is ever split over two lines.
+		struct line_format {
+			mut<usize> width;
+			u8string_view newline;
+
+			constexpr line_format(
+				usize width,
+				u8string_view const newline
+			) : width(width), newline(newline) {
+				if ( 0u == width || 0u != width % 4u ) {
+					throw std::invalid_argument("base64::line_format: width must be a positive multiple of 4");
+				}
+			}
+		};
+
+		namespace line {
+			// RFC 2045 section 6.8
+			constexpr line_format mime { 76u, u8"\r\n" };
+			// RFC 7468 section 2, which lets the newline be either; use { 64u, u8"\r\n" } for CRLF
+			constexpr line_format pem { 64u, u8"\n" };
+		} // namespace base64::detail::line
+
+		// Same as encoded_length(length), plus a newline between every two lines.
+		// Nothing follows the last line, which is shorter than `width` unless the input happens to fill it.
+		template<typename Alphabet = alphabet::standard>
+		constexpr mut<usize> encoded_length(
+			usize length,
+			line_format const format
+		) noexcept {
+			usize line_length = format.width / 4u * 3u;
+			usize lines = (length + line_length - 1u) / line_length;
+
+			return encoded_length<Alphabet>(length) + (0u == lines ? 0u : (lines - 1u) * format.newline.length());
+		}
+
+		// Lines encoded at once; their characters are still in L1 when they are spread out.
+		constexpr usize wrap_chunk_size = 4096u;
+
+		// Same as _encode_into, but with a newline after every `format.width` characters.
+		// `res` must have room for encoded_length<Alphabet>(input.length(), format) characters.
+		// Whole lines are handed to the kernels a chunk at a time, encoded into the far end of
+		// the chunk's part of `res`, and then moved forward to their places with the newlines in between.
+		// No line ever overwrites one that hasn't been moved yet, so `res` is the only buffer.
+		template<typename Alphabet>
+		constexpr void _encode_wrapped_into(
+			u8string_view const input,
+			line_format const format,
+			ptr<char8_t> res
+		) noexcept {
+			ptr<u8> data = input.data();
+			usize length = input.length();
+			usize width = format.width;
+			usize newline_length = format.newline.length();
+
+			if ( 0u == newline_length ) {
+				_encode_into<Alphabet>(input, res);
+
+				return;
+			}
+
+			usize line_length = width / 4u * 3u;
+			usize stride = width + newline_length;
+			usize chunk_lines = std::max<usize>(1u, wrap_chunk_size / stride);
+
+			mut<usize> byte_no = 0u;
+			mut<usize> result_counter = 0u;
+
+			// only lines followed by more input get a newline, the last one is left to _encode_into
+			while ( length - byte_no > line_length ) {
+				usize lines = std::min(chunk_lines, (length - byte_no - 1u) / line_length);
+
+				ptr<char8_t> chunk = res + result_counter;
+				ptr<char8_t> encoded = chunk + lines * newline_length;
+
+				encode_groups<Alphabet>(data + byte_no, lines * line_length, encoded);
+
+				for (mut<usize> line_no = 0u; line_no < lines; ++line_no) {
+					ptr<char8_t> destination = chunk + line_no * stride;
+
+					// moves forward by (lines - line_no) * newline_length, the newline ends where the next line starts at the earliest
+					std::copy_n(encoded + line_no * width, width, destination);
+					std::copy_n(format.newline.data(), newline_length, destination + width);
+				}
+
+				byte_no += lines * line_length;
+				result_counter += lines * stride;
+			}
+
+			_encode_into<Alphabet>(input.substr(byte_no), res + result_counter);
+		}
+
+		template<typename Alphabet>
+		constexpr mut<usize> _append_encode(
+			u8string& output,
+			u8string_view const input,
+			line_format const format
+		) {
+			usize final_length = encoded_length<Alphabet>(input.length(), format);
+
+			instrument::count_call(instrument::site::encode_wrapped, input.length());
+
+			append_uninitialized(output, final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				_encode_wrapped_into<Alphabet>(input, format, res);
+
+				return final_length;
+			});
+
+			return final_length;
+		}
+
+		template<typename Alphabet>
+		constexpr u8string _encode(
+			u8string_view const input,
+			line_format const format
+		) {
+			u8string return_value;
+
+			_append_encode<Alphabet>(return_value, input, format);
+
+			return return_value;
+		}
+
+		template<typename Alphabet>
+		constexpr mut<usize> _encode(
+			u8string_view const input,
+			line_format const format,
+			std::span<char8_t> const output
+		) {
+			usize final_length = encoded_length<Alphabet>(input.length(), format);
+
+			if ( output.size() < final_length ) {
+				throw std::length_error("base64::encode: output is shorter than encoded_length()");
+			}
+
+			instrument::count_call(instrument::site::encode_wrapped, input.length());
+
+			_encode_wrapped_into<Alphabet>(input, format, output.data());
+
+			return final_length;
+		}
+
+		// Converts every complete group of 4 base64 characters into 3 octets.
+		// `length` must not include the final group if it carries padding.
+		// Returns how many characters were consumed (always a multiple of 4).
+		// With check_validity, stops in front of the first group holding a
+		// character outside of the alphabet, so anything short of (length & ~3) means bad input.
+		template<bool const check_validity, typename Alphabet>
+		constexpr mut<usize> decode_groups_scalar(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
+			mut<usize> counter = 0u; // counter for `res`
+			mut<usize> char_no = 0u; // counter for what base64 char we're currently decoding
+
+			auto const& shifted = decode_shifted<Alphabet>;
+
+			// 2 groups per iteration out of one 64 bit load. Both groups are read before anything is written,
+			// and only 6 octets are written for the 8 characters read, so this still works in place.
+			for (; char_no + 8u <= length; char_no += 8u, counter += 6u) {
+				u64 characters = load_little_endian(data + char_no);
+
+				u32 first = shifted[0u][characters & 0xFFu] | shifted[1u][(characters >> 8u) & 0xFFu]
+					| shifted[2u][(characters >> 16u) & 0xFFu] | shifted[3u][(characters >> 24u) & 0xFFu];
+				u32 second = shifted[0u][(characters >> 32u) & 0xFFu] | shifted[1u][(characters >> 40u) & 0xFFu]
+					| shifted[2u][(characters >> 48u) & 0xFFu] | shifted[3u][characters >> 56u];
+
+				if constexpr (check_validity) {
+					// the loop below stops at the group that is to blame
+					if ( 0u != ((first | second) >> 24u) ) {
+						break;
+					}
+				}
+
+				res[counter + 0u] = static_cast<char8_t>(first >> 16u);
+				res[counter + 1u] = static_cast<char8_t>(first >> 8u);
+				res[counter + 2u] = static_cast<char8_t>(first);
+				res[counter + 3u] = static_cast<char8_t>(second >> 16u);
+				res[counter + 4u] = static_cast<char8_t>(second >> 8u);
+				res[counter + 5u] = static_cast<char8_t>(second);
+			}
+
+			for (; char_no + 4u <= length; char_no += 4u ) {
+				auto const temp = data + char_no;
+
+				if constexpr (check_validity) {
+					// one branch per group instead of one per character
+					if (
+						is_invalid_base64_char<Alphabet>[temp[0u]] | is_invalid_base64_char<Alphabet>[temp[1u]]
+						| is_invalid_base64_char<Alphabet>[temp[2u]] | is_invalid_base64_char<Alphabet>[temp[3u]]
+					) {
+						break;
+					}
+				}
+
+				// Get the numbers each character represents
+				// Since ascii is ONE BYTE, the worst that can happen is
 				// you get a bunch of 0's back (if the base64 string contained
 				// characters not in the base64 alphabet).
 				// The only way `base64::decode` will TELL you about this though
-				// is if you use pass <true> (particularly because
-				// there is a 3-4x performance hit, just for the integrity check.)
-				u8 A = unb64[temp[0u]];
-				u8 B = unb64[temp[1u]];
-				u8 C = unb64[temp[2u]];
-				u8 D = unb64[temp[3u]];
+				// is if you use pass <true>.
+				u8 A = unb64<Alphabet>[temp[0u]];
+				u8 B = unb64<Alphabet>[temp[1u]];
+				u8 C = unb64<Alphabet>[temp[2u]];
+				u8 D = unb64<Alphabet>[temp[3u]];
 
 				// Just unmap each sextet to THE NUMBER it represents.
 				// You then have to pack it in res,
@@ -323,46 +1611,2747 @@ namespace base64 {
 				res[counter++] = static_cast<u8>((C << 6u) | (D >> 0u)); // shove C up to top 2 bits, or with D
 			}
 
-			{
-				ptr<u8> temp = data + char_no;
+			return char_no;
+		}
 
-				if ( 1u == pad ) {
-					// 1 padding character.
-					//    data[0]     data[1]     data[2]
-					// +-----------+-----------+-----------+
-					// | 0000 0011   1111 1111   ~~~~ ~~~~ |
-					// +-AAAA AABB   BBBB CCCC   XXXX XXXX  
-					// We can pull 2 bytes out, not 3.
-					// We have 3 characters A, B and C, not 4.
-					u8 A = unb64[temp[0u]];
-					u8 B = unb64[temp[1u]];
-					u8 C = unb64[temp[2u]];
+#if BASE64_X86_SIMD
+		namespace ssse3 {
 
-					res[counter++] = static_cast<u8>((A << 2u) | (B >> 4u));
-					res[counter++] = static_cast<u8>((B << 4u) | (C >> 2u));
-				} else if ( 2u == pad ) {
-					u8 A = unb64[temp[0u]];
-					u8 B = unb64[temp[1u]];
+			// Translates 16 characters into their sextets and validates them in the same registers.
+			// The low and high nibble of every character each select a bit set from a 16 entry table;
+			// the two sets only intersect for characters outside of the alphabet, so one AND finds them all.
+			// Invalid characters come back as 0 ('A') and their lanes are flagged in `invalid`.
+			// The tables come from decode_nibbles_of<Alphabet>, for b64[] they are
+			// lo = { 0x15, 0x11 x 9, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A }, hi = { 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10... },
+			// roll = { 0, 0, 19, 4, -65, -65, -71, -71, 16 } with '/' as the only exception.
+			template<typename Alphabet>
+			__attribute__((target("ssse3")))
+			inline __m128i decode_lookup(
+				__m128i const characters,
+				__m128i& invalid
+			) noexcept {
+				constexpr decode_nibbles const& nibbles = decode_nibbles_of<Alphabet>;
 
-					res[counter++] = static_cast<u8>((A << 2u) | (B >> 4u));
+				__m128i const lut_lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(nibbles.lo.data()));
+				__m128i const lut_hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(nibbles.hi.data()));
+				// what to add to a character of each high nibble to get its sextet
+				__m128i const lut_roll = _mm_loadu_si128(reinterpret_cast<__m128i const*>(nibbles.roll.data()));
+				__m128i const mask_0F = _mm_set1_epi8(0x0F);
+
+				__m128i const hi_nibbles = _mm_and_si128(_mm_srli_epi32(characters, 4), mask_0F);
+				__m128i const lo_nibbles = _mm_and_si128(characters, mask_0F);
+
+				invalid = _mm_cmpgt_epi8(
+					_mm_and_si128(_mm_shuffle_epi8(lut_lo, lo_nibbles), _mm_shuffle_epi8(lut_hi, hi_nibbles)),
+					_mm_setzero_si128()
+				);
+
+				// characters that don't fit their nibble's range get a slot of their own
+				__m128i slots = hi_nibbles;
+
+				for (mut<usize> i = 0u; i < nibbles.exception_count; ++i) {
+					slots = _mm_add_epi8(slots, _mm_and_si128(
+						_mm_cmpeq_epi8(characters, _mm_set1_epi8(static_cast<char>(nibbles.exceptions[i]))),
+						_mm_set1_epi8(static_cast<char>(nibbles.exception_slots[i]))
+					));
+				}
+
+				__m128i const roll = _mm_shuffle_epi8(lut_roll, slots);
+
+				return _mm_andnot_si128(invalid, _mm_add_epi8(characters, roll));
+			}
+
+			// Translates the characters whose high nibble is `row` through that row of decode_table[],
+			// the others keep what they have in `translated`.
+			template<typename Alphabet, mut<usize> row>
+			__attribute__((target("ssse3")))
+			inline __m128i decode_row(
+				__m128i const characters,
+				__m128i const hi_nibbles,
+				__m128i const translated
+			) noexcept {
+				if constexpr ( 0u == (alphabet_rows<Alphabet> >> row & 1u) ) {
+					return translated;
+				} else {
+					__m128i const in_row = _mm_cmpeq_epi8(hi_nibbles, _mm_set1_epi8(static_cast<char>(row)));
+					__m128i const looked_up = _mm_shuffle_epi8(
+						_mm_loadu_si128(reinterpret_cast<__m128i const*>(decode_table<Alphabet>.data() + 16u * row)),
+						characters
+					);
+
+					return _mm_or_si128(_mm_and_si128(in_row, looked_up), _mm_andnot_si128(in_row, translated));
 				}
 			}
 
-			return std::make_optional<u8string>(
-				std::forward<u8string>(return_value)
-			);
-		}
+			// Alphabets that don't fit decode_lookup(): one pshufb for each row of 16 ASCII characters that holds some of it.
+			// Characters that stay at 0x80 are invalid, they come back as 0 and flagged in `invalid`.
+			template<typename Alphabet, mut<usize>... row>
+			__attribute__((target("ssse3")))
+			inline __m128i decode_lookup_rows(
+				__m128i const characters,
+				__m128i& invalid,
+				std::index_sequence<row...>
+			) noexcept {
+				__m128i const hi_nibbles = _mm_and_si128(_mm_srli_epi16(characters, 4), _mm_set1_epi8(0x0F));
+				__m128i translated = _mm_set1_epi8(static_cast<char>(0x80));
 
-		// `encode` as funcref is for consistency in the API
-		constexpr auto const& encode = _encode;
-		constexpr auto const& decode = _decode<true>;
-		constexpr auto const& decode_nocheck = _decode<false>;
+				((translated = decode_row<Alphabet, row>(characters, hi_nibbles, translated)), ...);
 
-	} // namespace base64::detail
+				invalid = _mm_cmpgt_epi8(_mm_setzero_si128(), translated);
 
-	// leak three into outer scope (base64)
-	using detail::encode;
-	using detail::decode;
-	using detail::decode_nocheck;
+				return _mm_and_si128(translated, _mm_set1_epi8(0x3F));
+			}
+
+			template<typename Alphabet>
+			__attribute__((target("ssse3")))
+			inline __m128i decode_characters(
+				__m128i const characters,
+				__m128i& invalid
+			) noexcept {
+				if constexpr ( decode_nibbles_of<Alphabet>.fits ) {
+					return decode_lookup<Alphabet>(characters, invalid);
+				} else {
+					return decode_lookup_rows<Alphabet>(characters, invalid, std::make_index_sequence<8u> {});
+				}
+			}
+
+			// Packs 4 sextets per 32 bit lane into 3 octets, in the low 12 bytes.
+			__attribute__((target("ssse3")))
+			inline __m128i decode_pack(
+				__m128i const sextets
+			) noexcept {
+				// 00DDDDDD 00CCCCCC 00BBBBBB 00AAAAAA => 0000CCCC CCDDDDDD 0000AAAA AABBBBBB
+				__m128i const merge_ab_and_cd = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+				// => 00000000 AAAAAABB BBBBCCCC CCDDDDDD
+				__m128i const merged = _mm_madd_epi16(merge_ab_and_cd, _mm_set1_epi32(0x00011000));
+
+				return _mm_shuffle_epi8(merged, _mm_setr_epi8(
+					2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+				));
+			}
+
+			// 16 base64 characters => 12 octets per iteration.
+			template<bool const check_validity, typename Alphabet>
+			__attribute__((target("ssse3")))
+			inline mut<usize> decode_groups(
+				ptr<u8> data,
+				usize length,
+				ptr<char8_t> res
+			) noexcept {
+				mut<usize> char_no = 0u;
+				mut<usize> counter = 0u;
+
+				// Every store writes 16 bytes but only advances by 12,
+				// so keep 2 more groups of input around to absorb the 4 extra bytes.
+				for (; char_no + 24u <= length; char_no += 16u, counter += 12u) {
+					__m128i invalid;
+					__m128i const sextets = decode_characters<Alphabet>(
+						_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + char_no)),
+						invalid
+					);
+
+					if constexpr (check_validity) {
+						// let the scalar loop find the exact group
+						if ( 0 != _mm_movemask_epi8(invalid) ) {
+							break;
+						}
+					}
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(res + counter), decode_pack(sextets));
+				}
+
+				return char_no + decode_groups_scalar<check_validity, Alphabet>(data + char_no, length - char_no, res + counter);
+			}
+
+		} // namespace base64::detail::ssse3
+
+		namespace avx2 {
+
+			// 256 bit version of ssse3::decode_lookup().
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline __m256i decode_lookup(
+				__m256i const characters,
+				__m256i& invalid
+			) noexcept {
+				constexpr decode_nibbles const& nibbles = decode_nibbles_of<Alphabet>;
+
+				__m256i const lut_lo = broadcast_row(nibbles.lo.data());
+				__m256i const lut_hi = broadcast_row(nibbles.hi.data());
+				__m256i const lut_roll = broadcast_row(nibbles.roll.data());
+				__m256i const mask_0F = _mm256_set1_epi8(0x0F);
+
+				__m256i const hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(characters, 4), mask_0F);
+				__m256i const lo_nibbles = _mm256_and_si256(characters, mask_0F);
+
+				invalid = _mm256_cmpgt_epi8(
+					_mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo_nibbles), _mm256_shuffle_epi8(lut_hi, hi_nibbles)),
+					_mm256_setzero_si256()
+				);
+
+				__m256i slots = hi_nibbles;
+
+				for (mut<usize> i = 0u; i < nibbles.exception_count; ++i) {
+					slots = _mm256_add_epi8(slots, _mm256_and_si256(
+						_mm256_cmpeq_epi8(characters, _mm256_set1_epi8(static_cast<char>(nibbles.exceptions[i]))),
+						_mm256_set1_epi8(static_cast<char>(nibbles.exception_slots[i]))
+					));
+				}
+
+				__m256i const roll = _mm256_shuffle_epi8(lut_roll, slots);
+
+				return _mm256_andnot_si256(invalid, _mm256_add_epi8(characters, roll));
+			}
+
+			// 256 bit version of ssse3::decode_row().
+			template<typename Alphabet, mut<usize> row>
+			__attribute__((target("avx2")))
+			inline __m256i decode_row(
+				__m256i const characters,
+				__m256i const hi_nibbles,
+				__m256i const translated
+			) noexcept {
+				if constexpr ( 0u == (alphabet_rows<Alphabet> >> row & 1u) ) {
+					return translated;
+				} else {
+					return _mm256_blendv_epi8(
+						translated,
+						_mm256_shuffle_epi8(broadcast_row(decode_table<Alphabet>.data() + 16u * row), characters),
+						_mm256_cmpeq_epi8(hi_nibbles, _mm256_set1_epi8(static_cast<char>(row)))
+					);
+				}
+			}
+
+			// 256 bit version of ssse3::decode_lookup_rows().
+			template<typename Alphabet, mut<usize>... row>
+			__attribute__((target("avx2")))
+			inline __m256i decode_lookup_rows(
+				__m256i const characters,
+				__m256i& invalid,
+				std::index_sequence<row...>
+			) noexcept {
+				__m256i const hi_nibbles = _mm256_and_si256(_mm256_srli_epi16(characters, 4), _mm256_set1_epi8(0x0F));
+				__m256i translated = _mm256_set1_epi8(static_cast<char>(0x80));
+
+				((translated = decode_row<Alphabet, row>(characters, hi_nibbles, translated)), ...);
+
+				invalid = _mm256_cmpgt_epi8(_mm256_setzero_si256(), translated);
+
+				return _mm256_and_si256(translated, _mm256_set1_epi8(0x3F));
+			}
+
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline __m256i decode_characters(
+				__m256i const characters,
+				__m256i& invalid
+			) noexcept {
+				if constexpr ( decode_nibbles_of<Alphabet>.fits ) {
+					return decode_lookup<Alphabet>(characters, invalid);
+				} else {
+					return decode_lookup_rows<Alphabet>(characters, invalid, std::make_index_sequence<8u> {});
+				}
+			}
+
+			// Packs 4 sextets per 32 bit lane into 3 octets, in the low 24 bytes.
+			__attribute__((target("avx2")))
+			inline __m256i decode_pack(
+				__m256i const sextets
+			) noexcept {
+				__m256i const merge_ab_and_cd = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+				__m256i const merged = _mm256_madd_epi16(merge_ab_and_cd, _mm256_set1_epi32(0x00011000));
+
+				__m256i const packed = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+					2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+					2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+				));
+
+				// close the 4 byte gap between the two 128 bit lanes
+				return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+			}
+
+			// 32 base64 characters => 24 octets per iteration.
+			template<bool const check_validity, typename Alphabet>
+			__attribute__((target("avx2")))
+			inline mut<usize> decode_groups(
+				ptr<u8> data,
+				usize length,
+				ptr<char8_t> res
+			) noexcept {
+				mut<usize> char_no = 0u;
+				mut<usize> counter = 0u;
+
+				// Every store writes 32 bytes but only advances by 24,
+				// so keep 3 more groups of input around to absorb the 8 extra bytes.
+				for (; char_no + 44u <= length; char_no += 32u, counter += 24u) {
+					__m256i invalid;
+					__m256i const sextets = decode_characters<Alphabet>(
+						_mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + char_no)),
+						invalid
+					);
+
+					if constexpr (check_validity) {
+						if ( 0 == _mm256_testz_si256(invalid, invalid) ) {
+							break;
+						}
+					}
+
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(res + counter), decode_pack(sextets));
+				}
+
+				return char_no + ssse3::decode_groups<check_validity, Alphabet>(data + char_no, length - char_no, res + counter);
+			}
+
+		} // namespace base64::detail::avx2
+
+		namespace avx512 {
+
+			// source byte of every output byte after the madd packing, 16 groups of 3
+			alignas(64) constexpr std::array<char8_t, 64> decode_gather = [] {
+				std::array<char8_t, 64> gather {};
+
+				for (mut<usize> i = 0u; i < 48u; ++i) {
+					gather[i] = static_cast<char8_t>(i / 3u * 4u + 2u - i % 3u);
+				}
+
+				return gather;
+			}();
+
+			// 64 base64 characters => 48 octets per iteration.
+			// vpermi2b translates all 64 characters through the 128 entry table at once;
+			// a character is invalid if it or its table entry has the top bit set,
+			// which vpmovb2m turns straight into a mask register. Works the same for every alphabet.
+			template<bool const check_validity, typename Alphabet>
+			__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+			inline mut<usize> decode_groups(
+				ptr<u8> data,
+				usize length,
+				ptr<char8_t> res
+			) noexcept {
+				__m512i const table_lo = _mm512_load_si512(decode_table<Alphabet>.data());
+				__m512i const table_hi = _mm512_load_si512(decode_table<Alphabet>.data() + 64u);
+				__m512i const gather = _mm512_load_si512(decode_gather.data());
+
+				mut<usize> char_no = 0u;
+				mut<usize> counter = 0u;
+
+				for (; char_no + 64u <= length; char_no += 64u, counter += 48u) {
+					__m512i const characters = _mm512_loadu_si512(data + char_no);
+					__m512i const translated = _mm512_permutex2var_epi8(table_lo, characters, table_hi);
+
+					__mmask64 const invalid = _mm512_movepi8_mask(_mm512_or_si512(translated, characters));
+
+					if constexpr (check_validity) {
+						// let the narrower kernels find the exact group
+						if ( 0u != invalid ) {
+							break;
+						}
+					}
+
+					// invalid characters decode as 'A' (0)
+					__m512i const sextets = _mm512_maskz_mov_epi8(~invalid, translated);
+
+					__m512i const merged = _mm512_madd_epi16(
+						_mm512_maddubs_epi16(sextets, _mm512_set1_epi32(0x01400140)),
+						_mm512_set1_epi32(0x00011000)
+					);
+
+					// only ever writes the 48 bytes that belong to this block
+					_mm512_mask_storeu_epi8(
+						res + counter,
+						0x0000FFFFFFFFFFFFull,
+						_mm512_maskz_permutexvar_epi8(every_byte, gather, merged)
+					);
+				}
+
+				return char_no + avx2::decode_groups<check_validity, Alphabet>(data + char_no, length - char_no, res + counter);
+			}
+
+		} // namespace base64::detail::avx512
+#endif
+
+		using decode_kernel = mut<usize> (*)(ptr<u8>, usize, ptr<char8_t>) noexcept;
+
+		// Picks the widest kernel this CPU can run.
+		template<bool const check_validity, typename Alphabet>
+		inline decode_kernel select_decode_kernel() noexcept {
+#if BASE64_X86_SIMD
+			__builtin_cpu_init();
+
+			if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+				return avx512::decode_groups<check_validity, Alphabet>;
+			}
+
+			if ( __builtin_cpu_supports("avx2") ) {
+				return avx2::decode_groups<check_validity, Alphabet>;
+			}
+
+			if ( __builtin_cpu_supports("ssse3") ) {
+				return ssse3::decode_groups<check_validity, Alphabet>;
+			}
+#endif
+			return decode_groups_scalar<check_validity, Alphabet>;
+		}
+
+#if defined(BASE64_INSTRUMENT)
+		template<bool const check_validity, typename Alphabet>
+		inline instrument::site decode_kernel_site(
+			decode_kernel const kernel
+		) noexcept {
+#if BASE64_X86_SIMD
+			if ( avx512::decode_groups<check_validity, Alphabet> == kernel ) {
+				return instrument::site::decode_avx512;
+			}
+
+			if ( avx2::decode_groups<check_validity, Alphabet> == kernel ) {
+				return instrument::site::decode_avx2;
+			}
+
+			if ( ssse3::decode_groups<check_validity, Alphabet> == kernel ) {
+				return instrument::site::decode_ssse3;
+			}
+#endif
+			return instrument::site::decode_scalar;
+		}
+#endif
+
+		// Same contract as decode_groups_scalar(), CPUID is only consulted on the first call.
+		template<bool const check_validity, typename Alphabet>
+		inline mut<usize> decode_groups_dispatched(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
+			static decode_kernel const kernel = select_decode_kernel<check_validity, Alphabet>();
+
+#if defined(BASE64_INSTRUMENT)
+			static instrument::site const where = decode_kernel_site<check_validity, Alphabet>(kernel);
+
+			instrument::count_call(where, length);
+#endif
+
+			return kernel(data, length, res);
+		}
+
+		template<bool const check_validity, typename Alphabet>
+		constexpr mut<usize> decode_groups(
+			ptr<u8> data,
+			usize length,
+			ptr<char8_t> res
+		) noexcept {
+			if ( std::is_constant_evaluated() ) {
+				return decode_groups_scalar<check_validity, Alphabet>(data, length, res);
+			}
+
+			return decode_groups_dispatched<check_validity, Alphabet>(data, length, res);
+		}
+
+		// Whether all `length` characters are in the alphabet: the range checks of the decode kernels
+		// without the translation and the stores, so validating runs at the speed of reading.
+		template<typename Alphabet>
+		constexpr bool all_in_alphabet_scalar(
+			ptr<u8> data,
+			usize length
+		) noexcept {
+			mut<bool> invalid = false;
+
+			// no early exit, a branch per character costs more than finishing the scan
+			for (mut<usize> char_no = 0u; char_no < length; ++char_no) {
+				invalid |= is_invalid_base64_char<Alphabet>[data[char_no]];
+			}
+
+			return !invalid;
+		}
+
+#if BASE64_X86_SIMD
+		namespace ssse3 {
+
+			template<typename Alphabet>
+			__attribute__((target("ssse3")))
+			inline bool all_in_alphabet(
+				ptr<u8> data,
+				usize length
+			) noexcept {
+				mut<usize> char_no = 0u;
+
+				for (; char_no + 16u <= length; char_no += 16u) {
+					__m128i invalid;
+
+					decode_characters<Alphabet>(_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + char_no)), invalid);
+
+					if ( 0 != _mm_movemask_epi8(invalid) ) {
+						return false;
+					}
+				}
+
+				return all_in_alphabet_scalar<Alphabet>(data + char_no, length - char_no);
+			}
+
+		} // namespace base64::detail::ssse3
+
+		namespace avx2 {
+
+			template<typename Alphabet>
+			__attribute__((target("avx2")))
+			inline bool all_in_alphabet(
+				ptr<u8> data,
+				usize length
+			) noexcept {
+				mut<usize> char_no = 0u;
+
+				for (; char_no + 32u <= length; char_no += 32u) {
+					__m256i invalid;
+
+					decode_characters<Alphabet>(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + char_no)), invalid);
+
+					if ( 0 == _mm256_testz_si256(invalid, invalid) ) {
+						return false;
+					}
+				}
+
+				return ssse3::all_in_alphabet<Alphabet>(data + char_no, length - char_no);
+			}
+
+		} // namespace base64::detail::avx2
+
+		namespace avx512 {
+
+			// 4 blocks of 64 per branch, the masks of a block are ORed into the ones before.
+			template<typename Alphabet>
+			__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+			inline bool all_in_alphabet(
+				ptr<u8> data,
+				usize length
+			) noexcept {
+				__m512i const table_lo = _mm512_load_si512(decode_table<Alphabet>.data());
+				__m512i const table_hi = _mm512_load_si512(decode_table<Alphabet>.data() + 64u);
+
+				mut<usize> char_no = 0u;
+
+				for (; char_no + 256u <= length; char_no += 256u) {
+					__m512i invalid = _mm512_setzero_si512();
+
+					for (mut<usize> block = 0u; block < 256u; block += 64u) {
+						__m512i const characters = _mm512_loadu_si512(data + char_no + block);
+
+						// the top bit of either the character or its table entry
+						invalid = _mm512_ternarylogic_epi32(
+							invalid,
+							characters,
+							_mm512_permutex2var_epi8(table_lo, characters, table_hi),
+							0xFE
+						);
+					}
+
+					if ( 0u != _mm512_movepi8_mask(invalid) ) {
+						return false;
+					}
+				}
+
+				return avx2::all_in_alphabet<Alphabet>(data + char_no, length - char_no);
+			}
+
+		} // namespace base64::detail::avx512
+#endif
+
+		using validate_kernel = bool (*)(ptr<u8>, usize) noexcept;
+
+		template<typename Alphabet>
+		inline validate_kernel select_validate_kernel() noexcept {
+#if BASE64_X86_SIMD
+			__builtin_cpu_init();
+
+			if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+				return avx512::all_in_alphabet<Alphabet>;
+			}
+
+			if ( __builtin_cpu_supports("avx2") ) {
+				return avx2::all_in_alphabet<Alphabet>;
+			}
+
+			if ( __builtin_cpu_supports("ssse3") ) {
+				return ssse3::all_in_alphabet<Alphabet>;
+			}
+#endif
+			return all_in_alphabet_scalar<Alphabet>;
+		}
+
+#if defined(BASE64_INSTRUMENT)
+		template<typename Alphabet>
+		inline instrument::site validate_kernel_site(
+			validate_kernel const kernel
+		) noexcept {
+#if BASE64_X86_SIMD
+			if ( avx512::all_in_alphabet<Alphabet> == kernel ) {
+				return instrument::site::validate_avx512;
+			}
+
+			if ( avx2::all_in_alphabet<Alphabet> == kernel ) {
+				return instrument::site::validate_avx2;
+			}
+
+			if ( ssse3::all_in_alphabet<Alphabet> == kernel ) {
+				return instrument::site::validate_ssse3;
+			}
+#endif
+			return instrument::site::validate_scalar;
+		}
+#endif
+
+		template<typename Alphabet>
+		inline bool all_in_alphabet_dispatched(
+			ptr<u8> data,
+			usize length
+		) noexcept {
+			static validate_kernel const kernel = select_validate_kernel<Alphabet>();
+
+#if defined(BASE64_INSTRUMENT)
+			static instrument::site const where = validate_kernel_site<Alphabet>(kernel);
+
+			instrument::count_call(where, length);
+#endif
+
+			return kernel(data, length);
+		}
+
+		template<typename Alphabet>
+		constexpr bool all_in_alphabet(
+			ptr<u8> data,
+			usize length
+		) noexcept {
+			if ( std::is_constant_evaluated() ) {
+				return all_in_alphabet_scalar<Alphabet>(data, length);
+			}
+
+			return all_in_alphabet_dispatched<Alphabet>(data, length);
+		}
+
+		// How many octets `input` decodes to, or nothing if it can't be base64 at all.
+		template<typename Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> decoded_length(
+			u8string_view const input
+		) noexcept {
+			ptr<u8> data = input.data();
+			usize length = input.length();
+
+			if constexpr ( !Alphabet::padded ) {
+				// A last group of 2 or 3 characters holds 1 or 2 octets, a single character can't hold any.
+				if ( 0u == length || 1u == length % 4u ) {
+					return std::nullopt;
+				}
+
+				return max_decoded_length(length);
+			}
+
+			if ( 0u == length || 0u != length % 4u ) {
+				// catch empty string, return nullopt as result.
+				// you passed an invalid base64 string (too short, or not whole groups of 4,
+				// which would have us write past the end of the result)
+				return std::nullopt;
+			}
+
+			// You take the ascii string len and divide it by 4
+			// to get #24lets (groups of 3 octets). You then * 3 to
+			// get #octets total.
+			return max_decoded_length(length)
+				- static_cast<mut<usize>>(u8'=' == data[length - 1u])
+				- static_cast<mut<usize>>(u8'=' == data[length - 2u]);
+		}
+
+		// `input` must have passed decoded_length<Alphabet>(), and `res` must have room for what it returned.
+		// Returns how many characters were decoded, input.length() unless check_validity is set
+		// and `input` isn't valid base64; then it is the offset of the first bad group,
+		// and `res` holds whatever was decoded in front of it.
+		// `res` may also be input.data() itself: every kernel loads a block before it stores
+		// the (shorter) result, and no store reaches past the characters it has already read.
+		template<bool const check_validity, typename Alphabet>
+		constexpr mut<usize> _decode_into(
+			u8string_view const input,
+			ptr<char8_t> res
+		) noexcept {
+			ptr<u8> data = input.data();
+			// the maximum value read out is 255,
+			// and the value is never negative. This is a type of
+			// "if statement" enforced by the type of the pointer.
+			// This eliminates a possible bounds check on array lookups into unb64[]
+			// (having values between 0 and 255 means it will always be
+			// inside the bounds of the 256 element array).
+			usize length = input.length();
+
+			// How many characters of the last group are not padding, 0 if it is complete.
+			mut<usize> tail = 0u;
+			mut<usize> unpadded_length = length;
+
+			if constexpr ( Alphabet::padded ) {
+				// Count == on the end to determine how much it was padded.
+				// 0..2
+				u8 pad = static_cast<u8>(u8'=' == data[length - 1u])
+					   + static_cast<u8>(u8'=' == data[length - 2u]);
+
+				// NEVER do the last group of 4 characters if either of the
+				// last 2 chars were pad.
+				if ( 0u != pad ) {
+					tail = 4u - pad;
+					unpadded_length -= 4u;
+				}
+			} else {
+				// without padding, the length alone tells how short the last group is
+				tail = length % 4u;
+				unpadded_length -= tail;
+			}
+
+			// Validation happens inside of the kernel, in the same pass as the translation.
+			usize char_no = decode_groups<check_validity, Alphabet>(data, unpadded_length, res);
+
+			if constexpr (check_validity) {
+				if ( unpadded_length != char_no ) {
+					// bad integrity.
+					return char_no;
+				}
+			}
+
+			mut<usize> counter = char_no / 4u * 3u;
+
+			{
+				ptr<u8> temp = data + char_no;
+
+				if ( 3u == tail ) {
+					// 1 padding character (or would have been).
+					//    data[0]     data[1]     data[2]
+					// +-----------+-----------+-----------+
+					// | 0000 0011   1111 1111   ~~~~ ~~~~ |
+					// +-AAAA AABB   BBBB CCCC   XXXX XXXX  
+					// We can pull 2 bytes out, not 3.
+					// We have 3 characters A, B and C, not 4.
+					if constexpr (check_validity) {
+						// Only last 2 can be '=', and if the 2nd last is '=' the last MUST be '=' too,
+						// so a '=' in C (as in "AA=A") is caught here as well.
+						if (
+							is_invalid_base64_char<Alphabet>[temp[0u]] | is_invalid_base64_char<Alphabet>[temp[1u]]
+							| is_invalid_base64_char<Alphabet>[temp[2u]]
+						) {
+							return char_no;
+						}
+					}
+
+					u8 A = unb64<Alphabet>[temp[0u]];
+					u8 B = unb64<Alphabet>[temp[1u]];
+					u8 C = unb64<Alphabet>[temp[2u]];
+
+					res[counter++] = static_cast<u8>((A << 2u) | (B >> 4u));
+					res[counter++] = static_cast<u8>((B << 4u) | (C >> 2u));
+				} else if ( 2u == tail ) {
+					if constexpr (check_validity) {
+						if ( is_invalid_base64_char<Alphabet>[temp[0u]] | is_invalid_base64_char<Alphabet>[temp[1u]] ) {
+							return char_no;
+						}
+					}
+
+					u8 A = unb64<Alphabet>[temp[0u]];
+					u8 B = unb64<Alphabet>[temp[1u]];
+
+					res[counter++] = static_cast<u8>((A << 2u) | (B >> 4u));
+				}
+			}
+
+			return length;
+		}
+
+		template<bool const check_validity>
+		constexpr instrument::site decode_site = check_validity ? instrument::site::decode : instrument::site::decode_nocheck;
+
+		template<bool const check_validity, typename Alphabet>
+		constexpr opt_ustring _decode(
+			u8string_view const input
+		) {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			instrument::count_call(decode_site<check_validity>, input.length());
+
+			if ( !final_length ) {
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return opt_ustring { std::nullopt };
+			}
+
+			u8string return_value;
+			mut<bool> integrity = true;
+
+			append_uninitialized(return_value, *final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				integrity = input.length() == _decode_into<check_validity, Alphabet>(input, res);
+
+				return *final_length;
+			});
+
+			if ( !integrity ) {
+				// bad integrity.
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return opt_ustring { std::nullopt };
+			}
+
+			return std::make_optional<u8string>(
+				std::forward<u8string>(return_value)
+			);
+		}
+
+		// Leaves `output` as it was if `input` isn't valid base64.
+		template<bool const check_validity, typename Alphabet>
+		constexpr std::optional<mut<usize>> _append_decode(
+			u8string& output,
+			u8string_view const input
+		) {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			instrument::count_call(decode_site<check_validity>, input.length());
+
+			if ( !final_length ) {
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return std::nullopt;
+			}
+
+			mut<bool> integrity = true;
+
+			append_uninitialized(output, *final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				integrity = input.length() == _decode_into<check_validity, Alphabet>(input, res);
+
+				return integrity ? *final_length : 0u;
+			});
+
+			if ( !integrity ) {
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return std::nullopt;
+			}
+
+			return final_length;
+		}
+
+		template<bool const check_validity, typename Alphabet>
+		constexpr std::optional<mut<usize>> _decode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			if ( !final_length ) {
+				instrument::count_call(decode_site<check_validity>, input.length());
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return std::nullopt;
+			}
+
+			if ( output.size() < *final_length ) {
+				throw std::length_error("base64::decode: output is shorter than the decoded length");
+			}
+
+			instrument::count_call(decode_site<check_validity>, input.length());
+
+			if ( input.length() != _decode_into<check_validity, Alphabet>(input, output.data()) ) {
+				instrument::count_rejected(decode_site<check_validity>);
+
+				return std::nullopt;
+			}
+
+			return final_length;
+		}
+
+		// Accepts exactly what decode<true, Alphabet>() accepts, without decoding it.
+		template<typename Alphabet>
+		constexpr std::optional<mut<usize>> _validate(
+			u8string_view const input
+		) noexcept {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			instrument::count_call(instrument::site::validate, input.length());
+
+			if ( !final_length ) {
+				instrument::count_rejected(instrument::site::validate);
+
+				return std::nullopt;
+			}
+
+			// the 0..2 '=' that decoded_length() has already counted
+			usize padding = max_decoded_length(input.length()) - *final_length;
+
+			if ( !all_in_alphabet<Alphabet>(input.data(), input.length() - padding) ) {
+				instrument::count_rejected(instrument::site::validate);
+
+				return std::nullopt;
+			}
+
+			return final_length;
+		}
+
+		// Decodes `buffer` over itself, the result starts at buffer.data().
+		template<typename Alphabet>
+		constexpr std::optional<mut<usize>> _decode_in_place(
+			std::span<char8_t> const buffer
+		) noexcept {
+			u8string_view const input = u8string_view(buffer.data(), buffer.size());
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			instrument::count_call(instrument::site::decode_in_place, input.length());
+
+			if ( !final_length ) {
+				instrument::count_rejected(instrument::site::decode_in_place);
+
+				return std::nullopt;
+			}
+
+			if ( input.length() != _decode_into<true, Alphabet>(input, buffer.data()) ) {
+				instrument::count_rejected(instrument::site::decode_in_place);
+
+				return std::nullopt;
+			}
+
+			return final_length;
+		}
+
+		enum class decode_error_kind : unsigned char {
+			// empty, or not a whole number of groups (a lone character, for unpadded alphabets)
+			invalid_length,
+			// a character outside of the alphabet
+			invalid_character,
+			// '=' anywhere but at the end of the last group, or at all for unpadded alphabets
+			invalid_padding
+		};
+
+		struct decode_error {
+			mut<decode_error_kind> kind;
+			// of the offending character; for invalid_length, of the incomplete group
+			mut<usize> offset;
+		};
+
+		// Tells what is wrong with `input`, given the offset of the first bad group that _decode_into() returned.
+		// Only that group is looked at again, so reporting the error costs O(1) rather than a second pass.
+		template<typename Alphabet>
+		constexpr decode_error _decode_error_at(
+			u8string_view const input,
+			usize char_no
+		) noexcept {
+			usize group_end = std::min(char_no + 4u, input.length());
+
+			for (mut<usize> i = char_no; i < group_end; ++i) {
+				if ( is_invalid_base64_char<Alphabet>[input[i]] ) {
+					return {
+						u8'=' == input[i] ? decode_error_kind::invalid_padding : decode_error_kind::invalid_character,
+						i
+					};
+				}
+			}
+
+			return { decode_error_kind::invalid_character, char_no };
+		}
+
+#if defined(__cpp_lib_expected)
+		template<typename Alphabet>
+		constexpr std::expected<mut<usize>, decode_error> _try_decode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			if ( !final_length ) {
+				instrument::count_call(instrument::site::try_decode, input.length());
+				instrument::count_rejected(instrument::site::try_decode);
+
+				return std::unexpected(decode_error { decode_error_kind::invalid_length, input.length() / 4u * 4u });
+			}
+
+			if ( output.size() < *final_length ) {
+				throw std::length_error("base64::try_decode: output is shorter than the decoded length");
+			}
+
+			instrument::count_call(instrument::site::try_decode, input.length());
+
+			usize char_no = _decode_into<true, Alphabet>(input, output.data());
+
+			if ( input.length() != char_no ) {
+				instrument::count_rejected(instrument::site::try_decode);
+
+				return std::unexpected(_decode_error_at<Alphabet>(input, char_no));
+			}
+
+			return *final_length;
+		}
+
+		template<typename Alphabet>
+		constexpr std::expected<u8string, decode_error> _try_decode(
+			u8string_view const input
+		) {
+			auto const final_length = decoded_length<Alphabet>(input);
+
+			instrument::count_call(instrument::site::try_decode, input.length());
+
+			if ( !final_length ) {
+				instrument::count_rejected(instrument::site::try_decode);
+
+				return std::unexpected(decode_error { decode_error_kind::invalid_length, input.length() / 4u * 4u });
+			}
+
+			u8string return_value;
+			mut<usize> char_no = 0u;
+
+			append_uninitialized(return_value, *final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				char_no = _decode_into<true, Alphabet>(input, res);
+
+				return *final_length;
+			});
+
+			if ( input.length() != char_no ) {
+				instrument::count_rejected(instrument::site::try_decode);
+
+				return std::unexpected(_decode_error_at<Alphabet>(input, char_no));
+			}
+
+			return return_value;
+		}
+#endif
+
+		// Encodes a stream of arbitrarily sized chunks with constant memory:
+		// the 0..2 bytes that don't make up a whole group yet are carried to the next update(),
+		// and finish() encodes them with padding. Inner chunks run through the same kernels as encode().
+		template<typename Alphabet>
+		class basic_encoder {
+			mut<char8_t> pending[3u] {};
+			mut<usize> pending_length = 0u;
+
+			// Writes whole groups only, returns the number of characters written.
+			mut<usize> _update(
+				u8string_view const input,
+				ptr<char8_t> res
+			) noexcept {
+				mut<usize> written = 0u;
+				mut<usize> byte_no = 0u;
+
+				instrument::count_call(instrument::site::encode_stream, input.length());
+
+				// complete the group the last chunk left open
+				if ( 0u != pending_length ) {
+					for (; pending_length < 3u && byte_no < input.length(); ++byte_no) {
+						pending[pending_length++] = input[byte_no];
+					}
+
+					if ( 3u > pending_length ) {
+						return 0u;
+					}
+
+					written += 4u * encode_groups<Alphabet>(pending, 3u, res) / 3u;
+					pending_length = 0u;
+				}
+
+				usize consumed = encode_groups<Alphabet>(input.data() + byte_no, input.length() - byte_no, res + written);
+
+				written += consumed / 3u * 4u;
+				byte_no += consumed;
+
+				for (; byte_no < input.length(); ++byte_no) {
+					pending[pending_length++] = input[byte_no];
+				}
+
+				return written;
+			}
+
+		public:
+			// Most characters update() can write for a chunk of `length` bytes. update() only writes
+			// whole groups, so this is 4 per started group with or without padding: up to 2 carried
+			// bytes can complete the group the chunk ends in.
+			static constexpr mut<usize> max_update_length(
+				usize length
+			) noexcept {
+				return (length + 2u) / 3u * 4u;
+			}
+
+			// Returns how many characters were written to `output`,
+			// throws std::length_error if it is shorter than max_update_length(input.length()).
+			mut<usize> update(
+				u8string_view const input,
+				std::span<char8_t> const output
+			) {
+				if ( output.size() < (pending_length + input.length()) / 3u * 4u ) {
+					throw std::length_error("base64::encoder::update: output is shorter than max_update_length()");
+				}
+
+				return _update(input, output.data());
+			}
+
+			mut<usize> update(
+				u8string_view const input,
+				u8string& output
+			) {
+				mut<usize> written = 0u;
+
+				append_uninitialized(output, (pending_length + input.length()) / 3u * 4u, [&](ptr<char8_t> res) noexcept {
+					return written = _update(input, res);
+				});
+
+				return written;
+			}
+
+			// Writes the last, padded group (0 or 4 characters, 0, 2 or 3 unpadded) and resets the encoder.
+			mut<usize> finish(
+				std::span<char8_t> const output
+			) {
+				usize final_length = encoded_length<Alphabet>(pending_length);
+
+				if ( output.size() < final_length ) {
+					throw std::length_error("base64::encoder::finish: output is shorter than 4 characters");
+				}
+
+				_encode_into<Alphabet>(u8string_view(pending, pending_length), output.data());
+				pending_length = 0u;
+
+				return final_length;
+			}
+
+			mut<usize> finish(
+				u8string& output
+			) {
+				usize final_length = encoded_length<Alphabet>(pending_length);
+
+				append_uninitialized(output, final_length, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+					_encode_into<Alphabet>(u8string_view(pending, pending_length), res);
+
+					return final_length;
+				});
+
+				pending_length = 0u;
+
+				return final_length;
+			}
+		};
+
+		// Decodes a stream of arbitrarily sized chunks with constant memory, always checking validity:
+		// 0..3 characters that don't make up a whole group yet are carried to the next update().
+		// A padded group ends the stream, any character after it is an error.
+		// Without padding, the last 2 or 3 characters can only be told apart from
+		// the start of another group at the end, so finish(output) decodes them.
+		// Once update() has failed the decoder stays failed.
+		template<typename Alphabet>
+		class basic_decoder {
+			mut<char8_t> pending[4u] {};
+			mut<usize> pending_length = 0u;
+			mut<bool> padded = false;
+			mut<bool> failed = false;
+
+			// Decodes one group that the kernels stopped at (or the group carried over),
+			// which is either the padded end of the stream or invalid.
+			bool _decode_group(
+				ptr<u8> group,
+				ptr<char8_t> res,
+				mut<usize>& written
+			) noexcept {
+				u8string_view const view = u8string_view(group, 4u);
+
+				if ( padded || 4u != _decode_into<true, Alphabet>(view, res) ) {
+					return false;
+				}
+
+				usize group_length = *decoded_length<Alphabet>(view);
+
+				padded = 3u != group_length;
+				written += group_length;
+
+				return true;
+			}
+
+			std::optional<mut<usize>> _update(
+				u8string_view const input,
+				ptr<char8_t> res
+			) noexcept {
+				mut<usize> written = 0u;
+				mut<usize> char_no = 0u;
+
+				instrument::count_call(instrument::site::decode_stream, input.length());
+
+				if ( failed ) {
+					return std::nullopt;
+				}
+
+				if ( 0u != pending_length ) {
+					for (; pending_length < 4u && char_no < input.length(); ++char_no) {
+						pending[pending_length++] = input[char_no];
+					}
+
+					if ( 4u > pending_length ) {
+						return 0u;
+					}
+
+					pending_length = 0u;
+
+					if ( !_decode_group(pending, res, written) ) {
+						failed = true;
+						instrument::count_rejected(instrument::site::decode_stream);
+
+						return std::nullopt;
+					}
+				}
+
+				ptr<u8> data = input.data() + char_no;
+				usize length = input.length() - char_no;
+				usize whole_length = length / 4u * 4u;
+
+				if ( padded && 0u != length ) {
+					// data after the padding
+					failed = true;
+					instrument::count_rejected(instrument::site::decode_stream);
+
+					return std::nullopt;
+				}
+
+				usize decoded = decode_groups<true, Alphabet>(data, whole_length, res + written);
+
+				written += decoded / 4u * 3u;
+
+				if ( decoded != whole_length ) {
+					// Either the final, padded group or a bad character.
+					// If it was padding, it has to be the very end of the stream.
+					if ( !_decode_group(data + decoded, res + written, written) || decoded + 4u != length ) {
+						failed = true;
+						instrument::count_rejected(instrument::site::decode_stream);
+
+						return std::nullopt;
+					}
+
+					return written;
+				}
+
+				for (mut<usize> i = whole_length; i < length; ++i) {
+					pending[pending_length++] = data[i];
+				}
+
+				return written;
+			}
+
+			// Decodes the carried over characters as the end of the stream and resets the decoder.
+			std::optional<mut<usize>> _finish(
+				ptr<char8_t> res
+			) noexcept {
+				mut<std::optional<mut<usize>>> written = 0u;
+
+				if ( failed ) {
+					written = std::nullopt;
+				} else if ( 0u != pending_length ) {
+					u8string_view const view = u8string_view(pending, pending_length);
+
+					// padded streams never end in the middle of a group
+					written = decoded_length<Alphabet>(view);
+
+					if ( !written || pending_length != _decode_into<true, Alphabet>(view, res) ) {
+						written = std::nullopt;
+						instrument::count_rejected(instrument::site::decode_stream);
+					}
+				}
+
+				pending_length = 0u;
+				padded = false;
+				failed = false;
+
+				return written;
+			}
+
+		public:
+			// Most octets update() can write for a chunk of `length` characters.
+			static constexpr mut<usize> max_update_length(
+				usize length
+			) noexcept {
+				return max_decoded_length(length + 3u);
+			}
+
+			// Returns how many octets were written to `output`, or nothing if the stream isn't valid base64.
+			// Throws std::length_error if `output` is shorter than max_update_length(input.length()).
+			std::optional<mut<usize>> update(
+				u8string_view const input,
+				std::span<char8_t> const output
+			) {
+				if ( output.size() < max_decoded_length(pending_length + input.length()) ) {
+					throw std::length_error("base64::decoder::update: output is shorter than max_update_length()");
+				}
+
+				return _update(input, output.data());
+			}
+
+			std::optional<mut<usize>> update(
+				u8string_view const input,
+				u8string& output
+			) {
+				std::optional<mut<usize>> written;
+
+				append_uninitialized(output, max_decoded_length(pending_length + input.length()), [&](ptr<char8_t> res) noexcept {
+					written = _update(input, res);
+
+					return written.value_or(0u);
+				});
+
+				return written;
+			}
+
+			// True if everything passed to update() was valid base64 made of whole groups.
+			// Resets the decoder for the next stream.
+			bool finish() noexcept requires ( Alphabet::padded ) {
+				bool const complete = !failed && 0u == pending_length;
+
+				if ( !failed && !complete ) {
+					// a stream cut off in the middle of a group
+					instrument::count_rejected(instrument::site::decode_stream);
+				}
+
+				pending_length = 0u;
+				padded = false;
+				failed = false;
+
+				return complete;
+			}
+
+			// Same, but also decodes the last, unpadded group (if any) into `output`.
+			// Returns how many octets were written (0..2), or nothing if the stream isn't valid base64.
+			// Throws std::length_error if `output` is shorter than 2 octets.
+			std::optional<mut<usize>> finish(
+				std::span<char8_t> const output
+			) {
+				if ( output.size() < max_decoded_length(pending_length) ) {
+					throw std::length_error("base64::decoder::finish: output is shorter than 2 octets");
+				}
+
+				return _finish(output.data());
+			}
+
+			std::optional<mut<usize>> finish(
+				u8string& output
+			) {
+				std::optional<mut<usize>> written;
+
+				append_uninitialized(output, max_decoded_length(pending_length), [&](ptr<char8_t> res) noexcept {
+					written = _finish(res);
+
+					return written.value_or(0u);
+				});
+
+				return written;
+			}
+		};
+
+		using encoder = basic_encoder<alphabet::standard>;
+		using decoder = basic_decoder<alphabet::standard>;
+
+		// ASCII whitespace, as isspace() in the "C" locale
+		constexpr std::array<bool, 0x100> is_whitespace = [] {
+			std::array<bool, 0x100> table {};
+
+			for (u8 character : u8string_view(u8" \t\n\v\f\r")) {
+				table[character] = true;
+			}
+
+			return table;
+		}();
+
+		// Offset of the first whitespace character, or `length` if there is none.
+		inline mut<usize> find_whitespace_scalar(
+			ptr<u8> data,
+			usize length
+		) noexcept {
+			mut<usize> char_no = 0u;
+
+			while ( char_no < length && !is_whitespace[data[char_no]] ) {
+				++char_no;
+			}
+
+			return char_no;
+		}
+
+#if BASE64_X86_SIMD
+		namespace avx2 {
+
+			// 32 characters per iteration, about 2 per line of MIME or PEM.
+			__attribute__((target("avx2")))
+			inline mut<usize> find_whitespace(
+				ptr<u8> data,
+				usize length
+			) noexcept {
+				mut<usize> char_no = 0u;
+
+				for (; char_no + 32u <= length; char_no += 32u) {
+					__m256i const characters = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + char_no));
+
+					// '\t' .. '\r' are the only characters below 5 once '\t' is subtracted
+					__m256i const control = _mm256_sub_epi8(characters, _mm256_set1_epi8('\t'));
+					__m256i const whitespace = _mm256_or_si256(
+						_mm256_cmpeq_epi8(characters, _mm256_set1_epi8(' ')),
+						_mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control)
+					);
+
+					auto const mask = static_cast<mut<unsigned>>(_mm256_movemask_epi8(whitespace));
+
+					if ( 0u != mask ) {
+						return char_no + static_cast<mut<usize>>(__builtin_ctz(mask));
+					}
+				}
+
+				return char_no + find_whitespace_scalar(data + char_no, length - char_no);
+			}
+
+		} // namespace base64::detail::avx2
+#endif
+
+		using find_kernel = mut<usize> (*)(ptr<u8>, usize) noexcept;
+
+		inline find_kernel select_find_whitespace_kernel() noexcept {
+#if BASE64_X86_SIMD
+			__builtin_cpu_init();
+
+			if ( __builtin_cpu_supports("avx2") ) {
+				return avx2::find_whitespace;
+			}
+#endif
+			return find_whitespace_scalar;
+		}
+
+		inline mut<usize> find_whitespace(
+			ptr<u8> data,
+			usize length
+		) noexcept {
+			static find_kernel const kernel = select_find_whitespace_kernel();
+
+			return kernel(data, length);
+		}
+
+		// Decodes `input` as if all of its whitespace had been removed, without making that copy:
+		// the runs of characters between line breaks go straight to the kernels through a basic_decoder,
+		// which carries the group that straddles a line break (if any) over to the next run.
+		// `res` must have room for max_decoded_length(input.length()) octets.
+		// Returns how many octets were written, or nothing if `input` isn't valid base64
+		// (which includes an `input` that is all whitespace, as decode() rejects empty strings).
+		template<typename Alphabet>
+		inline std::optional<mut<usize>> _decode_skip_whitespace_into(
+			u8string_view const input,
+			ptr<char8_t> res
+		) {
+			ptr<u8> data = input.data();
+			usize length = input.length();
+			usize capacity = max_decoded_length(length);
+
+			basic_decoder<Alphabet> decoder;
+			mut<usize> written = 0u;
+			mut<usize> char_no = 0u;
+			mut<bool> empty = true;
+
+			instrument::count_call(instrument::site::decode_skip_whitespace, length);
+
+			while ( char_no < length ) {
+				// line breaks are only 1 or 2 characters, no need for vectors here
+				while ( char_no < length && is_whitespace[data[char_no]] ) {
+					++char_no;
+				}
+
+				usize run = find_whitespace(data + char_no, length - char_no);
+
+				// never throws, the runs never hold more than what is left of `capacity`
+				auto const decoded = decoder.update(
+					input.substr(char_no, run),
+					std::span<char8_t>(res + written, capacity - written)
+				);
+
+				if ( !decoded ) {
+					instrument::count_rejected(instrument::site::decode_skip_whitespace);
+
+					return std::nullopt;
+				}
+
+				written += *decoded;
+				char_no += run;
+				empty &= 0u == run;
+			}
+
+			if ( empty ) {
+				instrument::count_rejected(instrument::site::decode_skip_whitespace);
+
+				return std::nullopt;
+			}
+
+			if constexpr ( Alphabet::padded ) {
+				if ( !decoder.finish() ) {
+					instrument::count_rejected(instrument::site::decode_skip_whitespace);
+
+					return std::nullopt;
+				}
+			} else {
+				auto const last = decoder.finish(std::span<char8_t>(res + written, capacity - written));
+
+				if ( !last ) {
+					instrument::count_rejected(instrument::site::decode_skip_whitespace);
+
+					return std::nullopt;
+				}
+
+				written += *last;
+			}
+
+			return written;
+		}
+
+		template<typename Alphabet>
+		inline opt_ustring _decode_skip_whitespace(
+			u8string_view const input
+		) {
+			u8string return_value;
+			std::optional<mut<usize>> written;
+
+			// whitespace only ever makes the result shorter than this
+			append_uninitialized(return_value, max_decoded_length(input.length()), [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				written = _decode_skip_whitespace_into<Alphabet>(input, res);
+
+				return written.value_or(0u);
+			});
+
+			if ( !written ) {
+				return opt_ustring { std::nullopt };
+			}
+
+			return std::make_optional<u8string>(
+				std::forward<u8string>(return_value)
+			);
+		}
+
+		template<typename Alphabet>
+		inline std::optional<mut<usize>> _decode_skip_whitespace(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			if ( output.size() < max_decoded_length(input.length()) ) {
+				throw std::length_error("base64::decode_skip_whitespace: output is shorter than max_decoded_length()");
+			}
+
+			return _decode_skip_whitespace_into<Alphabet>(input, output.data());
+		}
+
+		// Scatter / gather: the input and the output can each be a range of fragments
+		// (std::span<std::byte const>, u8string_view, std::vector<char8_t>, iovec-like structs turned into spans, ...)
+		// of any length, so a message never has to be linearized first.
+
+		// Anything contiguous with 1 byte elements.
+		template<typename Fragment>
+		concept byte_fragment = std::ranges::contiguous_range<Fragment>
+			&& std::ranges::sized_range<Fragment>
+			&& 1u == sizeof(std::ranges::range_value_t<Fragment>)
+			&& std::is_trivially_copyable_v<std::ranges::range_value_t<Fragment>>;
+
+		template<typename Fragments>
+		concept input_fragments = std::ranges::input_range<Fragments>
+			&& byte_fragment<std::remove_reference_t<std::ranges::range_reference_t<Fragments>> const>;
+
+		// ... and writable, for the output.
+		template<typename Fragments>
+		concept output_fragments = std::ranges::input_range<Fragments>
+			&& byte_fragment<std::remove_reference_t<std::ranges::range_reference_t<Fragments>>>
+			&& !std::is_const_v<std::remove_pointer_t<decltype(std::ranges::data(std::declval<std::ranges::range_reference_t<Fragments>>()))>>;
+
+		template<typename Fragment>
+		inline u8string_view fragment_view(
+			Fragment const& fragment
+		) noexcept {
+			return { reinterpret_cast<u8*>(std::ranges::data(fragment)), std::ranges::size(fragment) };
+		}
+
+		template<typename Fragment>
+		inline std::span<char8_t> fragment_span(
+			Fragment&& fragment
+		) noexcept {
+			return { reinterpret_cast<char8_t*>(std::ranges::data(fragment)), std::ranges::size(fragment) };
+		}
+
+		// Hands out the output fragments one after the other.
+		// Groups go straight into a fragment when they fit, the one straddling a boundary
+		// (if any) is made in a bounce buffer and copied over with write().
+		template<typename Fragments>
+		class fragment_writer {
+			std::ranges::iterator_t<Fragments> fragment;
+			std::ranges::sentinel_t<Fragments> end;
+			mut<std::span<char8_t>> current {};
+			mut<usize> total = 0u;
+
+		public:
+			explicit fragment_writer(
+				Fragments& fragments
+			) : fragment(std::ranges::begin(fragments)), end(std::ranges::end(fragments)) {}
+
+			// What is left of the current fragment, skipping empty ones; empty at the end of the output.
+			std::span<char8_t> room() {
+				while ( current.empty() && fragment != end ) {
+					current = fragment_span(*fragment);
+					++fragment;
+				}
+
+				return current;
+			}
+
+			// After writing `count` characters into room().
+			void advance(
+				usize count
+			) noexcept {
+				current = current.subspan(count);
+				total += count;
+			}
+
+			void write(
+				ptr<u8> data,
+				usize count
+			) {
+				for (mut<usize> written = 0u; written < count;) {
+					std::span<char8_t> const space = room();
+
+					if ( space.empty() ) {
+						throw std::length_error("base64: output fragments are shorter than the result");
+					}
+
+					usize chunk = std::min(space.size(), count - written);
+
+					std::copy_n(data + written, chunk, space.data());
+					advance(chunk);
+					written += chunk;
+				}
+			}
+
+			mut<usize> written() const noexcept {
+				return total;
+			}
+		};
+
+		// Feeds the input fragments through a basic_encoder, slicing them so that
+		// whatever update() writes fits into the current output fragment.
+		template<typename Alphabet, typename Input, typename Output>
+		inline mut<usize> _encode_fragments(
+			Input&& input,
+			Output&& output
+		) {
+			basic_encoder<Alphabet> encoder;
+			fragment_writer<std::remove_reference_t<Output>> writer(output);
+			mut<char8_t> bounce[4u];
+			// bytes carried over by the encoder, 0..2
+			mut<usize> pending = 0u;
+			mut<usize> length = 0u;
+
+			for (auto&& fragment : input) {
+				mut<u8string_view> rest = fragment_view(fragment);
+
+				length += rest.length();
+
+				while ( !rest.empty() ) {
+					std::span<char8_t> const room = writer.room();
+					usize groups = room.size() / 4u;
+
+					if ( 0u != groups ) {
+						usize take = std::min(rest.length(), groups * 3u - pending);
+
+						writer.advance(encoder.update(rest.substr(0u, take), room));
+						pending = (pending + take) % 3u;
+						rest.remove_prefix(take);
+					} else {
+						// the group that straddles two output fragments
+						usize take = std::min(rest.length(), 3u - pending);
+
+						writer.write(bounce, encoder.update(rest.substr(0u, take), std::span<char8_t>(bounce)));
+						pending = (pending + take) % 3u;
+						rest.remove_prefix(take);
+					}
+				}
+			}
+
+			writer.write(bounce, encoder.finish(std::span<char8_t>(bounce)));
+
+			// only known once single pass inputs have been read
+			instrument::count_call(instrument::site::encode_fragments, length);
+
+			return writer.written();
+		}
+
+		// The same with a basic_decoder. Nothing is returned for invalid input, which includes empty input.
+		template<typename Alphabet, typename Input, typename Output>
+		inline std::optional<mut<usize>> _decode_fragments(
+			Input&& input,
+			Output&& output
+		) {
+			basic_decoder<Alphabet> decoder;
+			fragment_writer<std::remove_reference_t<Output>> writer(output);
+			mut<char8_t> bounce[3u];
+			// characters carried over by the decoder, 0..3
+			mut<usize> pending = 0u;
+			mut<usize> length = 0u;
+			mut<bool> empty = true;
+
+			for (auto&& fragment : input) {
+				mut<u8string_view> rest = fragment_view(fragment);
+
+				length += rest.length();
+				empty &= rest.empty();
+
+				while ( !rest.empty() ) {
+					std::span<char8_t> const room = writer.room();
+					usize groups = room.size() / 3u;
+
+					// the group that straddles two output fragments goes through `bounce`
+					usize take = std::min(rest.length(), 0u != groups ? groups * 4u - pending : 4u - pending);
+
+					auto const decoded = decoder.update(rest.substr(0u, take), 0u != groups ? room : std::span<char8_t>(bounce));
+
+					if ( !decoded ) {
+						instrument::count_call(instrument::site::decode_fragments, length);
+						instrument::count_rejected(instrument::site::decode_fragments);
+
+						return std::nullopt;
+					}
+
+					if ( 0u != groups ) {
+						writer.advance(*decoded);
+					} else {
+						writer.write(bounce, *decoded);
+					}
+
+					pending = (pending + take) % 4u;
+					rest.remove_prefix(take);
+				}
+			}
+
+			if ( empty ) {
+				instrument::count_call(instrument::site::decode_fragments, length);
+				instrument::count_rejected(instrument::site::decode_fragments);
+
+				return std::nullopt;
+			}
+
+			if constexpr ( Alphabet::padded ) {
+				if ( !decoder.finish() ) {
+					instrument::count_call(instrument::site::decode_fragments, length);
+					instrument::count_rejected(instrument::site::decode_fragments);
+
+					return std::nullopt;
+				}
+			} else {
+				auto const last = decoder.finish(std::span<char8_t>(bounce));
+
+				if ( !last ) {
+					instrument::count_call(instrument::site::decode_fragments, length);
+					instrument::count_rejected(instrument::site::decode_fragments);
+
+					return std::nullopt;
+				}
+
+				writer.write(bounce, *last);
+			}
+
+			instrument::count_call(instrument::site::decode_fragments, length);
+
+			return writer.written();
+		}
+
+		template<typename Input>
+		inline mut<usize> fragments_length(
+			Input const& input
+		) noexcept {
+			mut<usize> length = 0u;
+
+			for (auto&& fragment : input) {
+				length += std::ranges::size(fragment);
+			}
+
+			return length;
+		}
+
+		template<typename Alphabet, typename Input>
+		inline u8string _encode_fragments(
+			Input const& input
+		) {
+			usize final_length = encoded_length<Alphabet>(fragments_length(input));
+
+			u8string return_value;
+
+			append_uninitialized_rethrow(return_value, final_length, [&](ptr<char8_t> res) -> mut<usize> {
+				std::span<char8_t> output[1u] { { res, final_length } };
+
+				return _encode_fragments<Alphabet>(input, output);
+			});
+
+			return return_value;
+		}
+
+		template<typename Alphabet, typename Input>
+		inline opt_ustring _decode_fragments(
+			Input const& input
+		) {
+			usize capacity = max_decoded_length(fragments_length(input));
+
+			u8string return_value;
+			std::optional<mut<usize>> written;
+
+			append_uninitialized_rethrow(return_value, capacity, [&](ptr<char8_t> res) -> mut<usize> {
+				std::span<char8_t> output[1u] { { res, capacity } };
+
+				written = _decode_fragments<Alphabet>(input, output);
+
+				return written.value_or(0u);
+			});
+
+			if ( !written ) {
+				return opt_ustring { std::nullopt };
+			}
+
+			return std::make_optional<u8string>(
+				std::forward<u8string>(return_value)
+			);
+		}
+
+		// Results of a batch call, back to back in one arena.
+		// Item i is arena[offsets[i], offsets[i + 1]), so there is one more offset than items.
+		struct batch {
+			u8string arena;
+			std::vector<mut<usize>> offsets { 0u };
+
+			mut<usize> size() const noexcept {
+				return offsets.size() - 1u;
+			}
+
+			u8string_view operator[](
+				usize i
+			) const noexcept {
+				return u8string_view(arena).substr(offsets[i], offsets[i + 1u] - offsets[i]);
+			}
+
+			// keeps the capacity of both vectors for the next batch
+			void clear() noexcept {
+				arena.clear();
+				offsets.assign(1u, 0u);
+			}
+		};
+
+		// Items from this length up reach the 24 byte blocks of avx2::encode_groups() (which reads 28),
+		// and measured faster there than side by side in encode_lanes().
+		constexpr usize max_lane_length = 28u;
+
+		// One pass sizes every item, then all of them are encoded into a single
+		// allocation (none at all when `output` is reused and already big enough).
+		template<typename Alphabet>
+		inline void _encode_batch(
+			std::span<u8string_view const> const inputs,
+			batch& output
+		) {
+			output.clear();
+			output.offsets.resize(inputs.size() + 1u);
+
+			mut<usize> total = 0u;
+
+			for (mut<usize> i = 0u; i < inputs.size(); ++i) {
+				total += encoded_length<Alphabet>(inputs[i].length());
+				output.offsets[i + 1u] = total;
+
+				instrument::count_call(instrument::site::encode_batch, inputs[i].length());
+			}
+
+			append_uninitialized(output.arena, total, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				// Short items are collected lane_count at a time and encoded side by side,
+				// long ones are better off with the block kernels on their own.
+				mut<u8*> lane_data[lane_count];
+				mut<char8_t*> lane_res[lane_count];
+				mut<usize> lane_items[lane_count];
+				mut<usize> lanes = 0u;
+
+				for (mut<usize> i = 0u; i < inputs.size(); ++i) {
+					if ( inputs[i].length() >= max_lane_length || inputs[i].length() < 3u ) {
+						_encode_into<Alphabet>(inputs[i], res + output.offsets[i]);
+
+						continue;
+					}
+
+					lane_data[lanes] = inputs[i].data();
+					lane_res[lanes] = res + output.offsets[i];
+					lane_items[lanes] = i;
+
+					if ( lane_count != ++lanes ) {
+						continue;
+					}
+
+					mut<usize> groups = max_lane_length;
+
+					for (usize item : lane_items) {
+						groups = std::min(groups, inputs[item].length() / 3u);
+					}
+
+					encode_lanes<Alphabet>(lane_data, lane_res, groups);
+
+					// the padding, and whatever the shortest item didn't have in common with the rest
+					for (usize item : lane_items) {
+						u8string_view const rest = inputs[item].substr(3u * groups);
+						ptr<char8_t> rest_res = res + output.offsets[item] + 4u * groups;
+
+						if ( rest.length() < 3u ) {
+							encode_last_group<Alphabet>(rest.data(), (3u - rest.length()) % 3u, rest_res);
+						} else {
+							_encode_into<Alphabet>(rest, rest_res);
+						}
+					}
+
+					lanes = 0u;
+				}
+
+				for (mut<usize> lane = 0u; lane < lanes; ++lane) {
+					_encode_into<Alphabet>(inputs[lane_items[lane]], lane_res[lane]);
+				}
+
+				return total;
+			});
+		}
+
+		// Leaves `output` empty and returns false if any of the items isn't valid base64.
+		template<typename Alphabet>
+		inline bool _decode_batch(
+			std::span<u8string_view const> const inputs,
+			batch& output
+		) {
+			output.clear();
+			output.offsets.resize(inputs.size() + 1u);
+
+			mut<usize> total = 0u;
+
+			for (mut<usize> i = 0u; i < inputs.size(); ++i) {
+				auto const final_length = decoded_length<Alphabet>(inputs[i]);
+
+				instrument::count_call(instrument::site::decode_batch, inputs[i].length());
+
+				if ( !final_length ) {
+					instrument::count_rejected(instrument::site::decode_batch);
+					output.clear();
+
+					return false;
+				}
+
+				total += *final_length;
+				output.offsets[i + 1u] = total;
+			}
+
+			mut<bool> integrity = true;
+
+			append_uninitialized(output.arena, total, [&](ptr<char8_t> res) noexcept -> mut<usize> {
+				for (mut<usize> i = 0u; i < inputs.size() && integrity; ++i) {
+					integrity = inputs[i].length() == _decode_into<true, Alphabet>(inputs[i], res + output.offsets[i]);
+				}
+
+				return integrity ? total : 0u;
+			});
+
+			if ( !integrity ) {
+				instrument::count_rejected(instrument::site::decode_batch);
+				output.clear();
+			}
+
+			return integrity;
+		}
+
+		inline std::span<char8_t> as_chars(
+			std::span<std::byte> const bytes
+		) noexcept {
+			return { reinterpret_cast<char8_t*>(bytes.data()), bytes.size() };
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr u8string encode(
+			u8string_view const input
+		) {
+			return _encode<Alphabet>(input);
+		}
+
+		// The span overloads write into caller owned memory and return how much of it they used.
+		// They throw std::length_error if `output` is too short, size it with
+		// encoded_length() / max_decoded_length() up front.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr mut<usize> encode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			return _encode<Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline mut<usize> encode(
+			u8string_view const input,
+			std::span<std::byte> const output
+		) {
+			return _encode<Alphabet>(input, as_chars(output));
+		}
+
+		// The append overloads grow `output` in place, so building a message field by field
+		// only reallocates when its capacity runs out. `input` must not point into `output`.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr mut<usize> append_encode(
+			u8string& output,
+			u8string_view const input
+		) {
+			return _append_encode<Alphabet>(output, input);
+		}
+
+		// Line wrapped output, such as MIME parts (line::mime) and PEM bodies (line::pem),
+		// with the newlines written by the encoding loop itself rather than by a second pass.
+		// The output has exactly encoded_length(input.length(), format) characters.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr u8string encode(
+			u8string_view const input,
+			line_format const format
+		) {
+			return _encode<Alphabet>(input, format);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr mut<usize> encode(
+			u8string_view const input,
+			line_format const format,
+			std::span<char8_t> const output
+		) {
+			return _encode<Alphabet>(input, format, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline mut<usize> encode(
+			u8string_view const input,
+			line_format const format,
+			std::span<std::byte> const output
+		) {
+			return _encode<Alphabet>(input, format, as_chars(output));
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr mut<usize> append_encode(
+			u8string& output,
+			u8string_view const input,
+			line_format const format
+		) {
+			return _append_encode<Alphabet>(output, input, format);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr opt_ustring decode(
+			u8string_view const input
+		) {
+			return _decode<true, Alphabet>(input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> decode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			return _decode<true, Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<mut<usize>> decode(
+			u8string_view const input,
+			std::span<std::byte> const output
+		) {
+			return _decode<true, Alphabet>(input, as_chars(output));
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> append_decode(
+			u8string& output,
+			u8string_view const input
+		) {
+			return _append_decode<true, Alphabet>(output, input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr opt_ustring decode_nocheck(
+			u8string_view const input
+		) {
+			return _decode<false, Alphabet>(input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> decode_nocheck(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			return _decode<false, Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<mut<usize>> decode_nocheck(
+			u8string_view const input,
+			std::span<std::byte> const output
+		) {
+			return _decode<false, Alphabet>(input, as_chars(output));
+		}
+
+		// Same as decode, except that ASCII whitespace anywhere in `input` is skipped,
+		// so line wrapped MIME parts and PEM bodies decode without stripping their line breaks first.
+		// The span overloads need room for max_decoded_length(input.length()) octets.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline opt_ustring decode_skip_whitespace(
+			u8string_view const input
+		) {
+			return _decode_skip_whitespace<Alphabet>(input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<mut<usize>> decode_skip_whitespace(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			return _decode_skip_whitespace<Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<mut<usize>> decode_skip_whitespace(
+			u8string_view const input,
+			std::span<std::byte> const output
+		) {
+			return _decode_skip_whitespace<Alphabet>(input, as_chars(output));
+		}
+
+		// Checks that decode() would accept `input`, at about the speed of reading it and without allocating.
+		// Returns the exact length it decodes to (the same as decoded_length(), which only looks at
+		// the length and the padding), or nothing if it isn't valid base64.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> validate(
+			u8string_view const input
+		) noexcept {
+			return _validate<Alphabet>(input);
+		}
+
+		// Decodes `buffer` into its own first decoded_length() bytes, without a second buffer;
+		// returns how many that is. If `buffer` isn't valid base64, nothing is returned
+		// and its leading part may already have been overwritten.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::optional<mut<usize>> decode_in_place(
+			std::span<char8_t> const buffer
+		) noexcept {
+			return _decode_in_place<Alphabet>(buffer);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<mut<usize>> decode_in_place(
+			std::span<std::byte> const buffer
+		) noexcept {
+			return _decode_in_place<Alphabet>(as_chars(buffer));
+		}
+
+		// Gather: the input is a range of fragments of any length, e.g. std::vector<std::span<std::byte const>>.
+		// Groups that straddle two fragments are carried over, nothing is linearized.
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> && std::ranges::forward_range<Input> )
+		inline u8string encode(
+			Input const& input
+		) {
+			return _encode_fragments<Alphabet>(input);
+		}
+
+		// Into one contiguous buffer, or scattered over a range of output fragments that are
+		// filled in order. Throws std::length_error if they run out; the result is exactly
+		// encoded_length() of the total input, or at most max_decoded_length() when decoding.
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> )
+		inline mut<usize> encode(
+			Input&& input,
+			std::span<char8_t> const output
+		) {
+			std::span<char8_t> fragments[1u] { output };
+
+			return _encode_fragments<Alphabet>(input, fragments);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> )
+		inline mut<usize> encode(
+			Input&& input,
+			std::span<std::byte> const output
+		) {
+			std::span<char8_t> fragments[1u] { as_chars(output) };
+
+			return _encode_fragments<Alphabet>(input, fragments);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input, typename Output>
+			requires ( input_fragments<Input> && output_fragments<Output> )
+		inline mut<usize> encode(
+			Input&& input,
+			Output&& output
+		) {
+			return _encode_fragments<Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> && std::ranges::forward_range<Input> )
+		inline opt_ustring decode(
+			Input const& input
+		) {
+			return _decode_fragments<Alphabet>(input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> )
+		inline std::optional<mut<usize>> decode(
+			Input&& input,
+			std::span<char8_t> const output
+		) {
+			std::span<char8_t> fragments[1u] { output };
+
+			return _decode_fragments<Alphabet>(input, fragments);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input>
+			requires ( input_fragments<Input> )
+		inline std::optional<mut<usize>> decode(
+			Input&& input,
+			std::span<std::byte> const output
+		) {
+			std::span<char8_t> fragments[1u] { as_chars(output) };
+
+			return _decode_fragments<Alphabet>(input, fragments);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard, typename Input, typename Output>
+			requires ( input_fragments<Input> && output_fragments<Output> )
+		inline std::optional<mut<usize>> decode(
+			Input&& input,
+			Output&& output
+		) {
+			return _decode_fragments<Alphabet>(input, output);
+		}
+
+#if defined(__cpp_lib_expected)
+		// Same as decode, but says why `input` was rejected and where, from the same single pass:
+		// the kernels stop at the first bad group, and only that group is looked at again.
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::expected<u8string, decode_error> try_decode(
+			u8string_view const input
+		) {
+			return _try_decode<Alphabet>(input);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		constexpr std::expected<mut<usize>, decode_error> try_decode(
+			u8string_view const input,
+			std::span<char8_t> const output
+		) {
+			return _try_decode<Alphabet>(input, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::expected<mut<usize>, decode_error> try_decode(
+			u8string_view const input,
+			std::span<std::byte> const output
+		) {
+			return _try_decode<Alphabet>(input, as_chars(output));
+		}
+#endif
+
+		// Fixed size overloads, for payloads whose size is known at compile time (digests, keys, UUIDs).
+		// Every group is expanded separately and the padding is decided by `if constexpr`,
+		// so there are no loops, no tail branches and no heap; both work in constant expressions:
+		//     constexpr auto text = base64::encode<4>(bytes);          // std::array<char8_t, 8>
+		//     constexpr auto key = base64::decode<16>(u8"...");        // std::optional<std::array<std::byte, 16>>
+
+		// A std::span of dynamic extent would give length == std::dynamic_extent; it is no fixed size.
+		template<mut<usize> length, alphabet_policy Alphabet = alphabet::standard>
+			requires ( std::dynamic_extent != length )
+		constexpr std::array<char8_t, encoded_length<Alphabet>(length)> encode(
+			std::span<std::byte const, length> const input
+		) noexcept {
+			std::array<char8_t, encoded_length<Alphabet>(length)> result;
+
+			auto const byte = [&](usize i) constexpr noexcept -> mut<unsigned> {
+				return std::to_integer<mut<unsigned>>(input[i]);
+			};
+
+			[&]<mut<usize>... group>(std::index_sequence<group...>) constexpr noexcept {
+				((
+					result[4u * group + 0u] = Alphabet::characters[byte(3u * group) >> 2u],
+					result[4u * group + 1u] = Alphabet::characters[((0x3u & byte(3u * group)) << 4u) + (byte(3u * group + 1u) >> 4u)],
+					result[4u * group + 2u] = Alphabet::characters[((0x0Fu & byte(3u * group + 1u)) << 2u) + (byte(3u * group + 2u) >> 6u)],
+					result[4u * group + 3u] = Alphabet::characters[0x3Fu & byte(3u * group + 2u)]
+				), ...);
+			}(std::make_index_sequence<length / 3u> {});
+
+			constexpr usize last = length / 3u * 3u;
+			constexpr usize result_last = length / 3u * 4u;
+
+			if constexpr ( 1u == length % 3u ) {
+				result[result_last + 0u] = Alphabet::characters[byte(last) >> 2u];
+				result[result_last + 1u] = Alphabet::characters[(0x3u & byte(last)) << 4u];
+
+				if constexpr ( Alphabet::padded ) {
+					result[result_last + 2u] = u8'=';
+					result[result_last + 3u] = u8'=';
+				}
+			} else if constexpr ( 2u == length % 3u ) {
+				result[result_last + 0u] = Alphabet::characters[byte(last) >> 2u];
+				result[result_last + 1u] = Alphabet::characters[((0x3u & byte(last)) << 4u) + (byte(last + 1u) >> 4u)];
+				result[result_last + 2u] = Alphabet::characters[(0x0Fu & byte(last + 1u)) << 2u];
+
+				if constexpr ( Alphabet::padded ) {
+					result[result_last + 3u] = u8'=';
+				}
+			}
+
+			return result;
+		}
+
+		// `length` is the decoded size, so `input` must be exactly encoded_length<Alphabet>(length) characters,
+		// with exactly the padding that implies.
+		template<mut<usize> length, alphabet_policy Alphabet = alphabet::standard>
+			requires ( std::dynamic_extent != length )
+		constexpr std::optional<std::array<std::byte, length>> decode(
+			u8string_view const input
+		) noexcept {
+			if ( input.length() != encoded_length<Alphabet>(length) ) {
+				return std::nullopt;
+			}
+
+			std::array<std::byte, length> result;
+
+			// invalid characters are OR'd together and checked once, at the end
+			mut<bool> invalid = false;
+
+			auto const sextet = [&](usize i) constexpr noexcept -> mut<unsigned> {
+				invalid |= is_invalid_base64_char<Alphabet>[input[i]];
+
+				return unb64<Alphabet>[input[i]];
+			};
+
+			[&]<mut<usize>... group>(std::index_sequence<group...>) constexpr noexcept {
+				((
+					result[3u * group + 0u] = static_cast<std::byte>((sextet(4u * group) << 2u) | (sextet(4u * group + 1u) >> 4u)),
+					result[3u * group + 1u] = static_cast<std::byte>((sextet(4u * group + 1u) << 4u) | (sextet(4u * group + 2u) >> 2u)),
+					result[3u * group + 2u] = static_cast<std::byte>((sextet(4u * group + 2u) << 6u) | sextet(4u * group + 3u))
+				), ...);
+			}(std::make_index_sequence<length / 3u> {});
+
+			constexpr usize last = length / 3u * 3u;
+			constexpr usize input_last = length / 3u * 4u;
+
+			if constexpr ( 1u == length % 3u ) {
+				result[last] = static_cast<std::byte>((sextet(input_last) << 2u) | (sextet(input_last + 1u) >> 4u));
+
+				if constexpr ( Alphabet::padded ) {
+					invalid |= u8'=' != input[input_last + 2u] || u8'=' != input[input_last + 3u];
+				}
+			} else if constexpr ( 2u == length % 3u ) {
+				result[last + 0u] = static_cast<std::byte>((sextet(input_last) << 2u) | (sextet(input_last + 1u) >> 4u));
+				result[last + 1u] = static_cast<std::byte>((sextet(input_last + 1u) << 4u) | (sextet(input_last + 2u) >> 2u));
+
+				if constexpr ( Alphabet::padded ) {
+					invalid |= u8'=' != input[input_last + 3u];
+				}
+			}
+
+			if ( invalid ) {
+				return std::nullopt;
+			}
+
+			return result;
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline batch encode_batch(
+			std::span<u8string_view const> const inputs
+		) {
+			batch output;
+
+			_encode_batch<Alphabet>(inputs, output);
+
+			return output;
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline void encode_batch(
+			std::span<u8string_view const> const inputs,
+			batch& output
+		) {
+			_encode_batch<Alphabet>(inputs, output);
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline std::optional<batch> decode_batch(
+			std::span<u8string_view const> const inputs
+		) {
+			batch output;
+
+			if ( !_decode_batch<Alphabet>(inputs, output) ) {
+				return std::nullopt;
+			}
+
+			return std::make_optional<batch>(std::move(output));
+		}
+
+		template<alphabet_policy Alphabet = alphabet::standard>
+		inline bool decode_batch(
+			std::span<u8string_view const> const inputs,
+			batch& output
+		) {
+			return _decode_batch<Alphabet>(inputs, output);
+		}
+
+		namespace parallel {
+
+			// Below this many input bytes per task, starting threads costs more than they save.
+			constexpr usize min_chunk_length = usize { 1u } << 20u;
+
+			inline mut<usize> hardware_threads() noexcept {
+				usize threads = std::thread::hardware_concurrency();
+
+				return 0u == threads ? 1u : threads;
+			}
+
+			// Splits `length` into about `workers` chunks of whole groups of `group_length`.
+			constexpr mut<usize> chunk_length(
+				usize length,
+				usize workers,
+				usize group_length
+			) noexcept {
+				usize even_share = (length + workers - 1u) / workers;
+				usize share = even_share < min_chunk_length ? min_chunk_length : even_share;
+
+				return (share + group_length - 1u) / group_length * group_length;
+			}
+
+			// Runs task(0) .. task(count - 1), task(0) on the calling thread.
+			template<typename Task>
+			inline void run_on_threads(
+				usize count,
+				Task const& task
+			) {
+				std::vector<std::jthread> threads;
+
+				threads.reserve(count - 1u);
+
+				for (mut<usize> i = 1u; i < count; ++i) {
+					threads.emplace_back([&task, i] { task(i); });
+				}
+
+				task(0u);
+				// ~jthread joins
+			}
+
+			// Runs task(0) .. task(count - 1) on `executor` and waits until all of them finished.
+			// If the executor throws, it is taken not to have accepted that task; the ones it did accept
+			// refer to `done` and `task`, so they are waited for before the exception is passed on.
+			template<typename Executor, typename Task>
+			inline void run_on_executor(
+				Executor& executor,
+				usize count,
+				Task const& task
+			) {
+				std::latch done(static_cast<std::ptrdiff_t>(count));
+				mut<usize> posted = 0u;
+
+				try {
+					for (; posted < count; ++posted) {
+						executor(std::function<void()>([&task, &done, i = posted] {
+							task(i);
+							done.count_down();
+						}));
+					}
+				} catch (...) {
+					done.count_down(static_cast<std::ptrdiff_t>(count - posted));
+					done.wait();
+
+					throw;
+				}
+
+				done.wait();
+			}
+
+			// Chunks are whole groups of 3 octets, so each one encodes on its own into
+			// its own range of `res`; only the last one can carry padding.
+			template<typename Alphabet, typename Run>
+			inline void _encode_into(
+				u8string_view const input,
+				ptr<char8_t> res,
+				usize workers,
+				Run const& run
+			) {
+				usize chunk = chunk_length(input.length(), workers, 3u);
+				usize chunks = (input.length() + chunk - 1u) / chunk;
+
+				if ( chunks < 2u ) {
+					detail::_encode_into<Alphabet>(input, res);
+
+					return;
+				}
+
+				run(chunks, [&](usize i) noexcept {
+					usize first = i * chunk;
+
+					detail::_encode_into<Alphabet>(input.substr(first, chunk), res + first / 3u * 4u);
+				});
+			}
+
+			// Chunks are whole groups of 4 characters. Inner chunks go straight to the group
+			// kernels, so a '=' in them is invalid; only the last chunk may end in padding.
+			// Returns the offset of the first invalid group in all of `input`, or input.length().
+			template<bool const check_validity, typename Alphabet, typename Run>
+			inline mut<usize> _decode_into(
+				u8string_view const input,
+				ptr<char8_t> res,
+				usize workers,
+				Run const& run
+			) {
+				usize chunk = chunk_length(input.length(), workers, 4u);
+				usize chunks = (input.length() + chunk - 1u) / chunk;
+
+				if ( chunks < 2u ) {
+					return detail::_decode_into<check_validity, Alphabet>(input, res);
+				}
+
+				// Every chunk notes where it failed; the first failing chunk holds the first bad group.
+				std::vector<mut<usize>> decoded(chunks);
+
+				run(chunks, [&](usize i) noexcept {
+					usize first = i * chunk;
+					u8string_view const part = input.substr(first, chunk);
+
+					decoded[i] = first + (
+						chunks - 1u == i
+							? detail::_decode_into<check_validity, Alphabet>(part, res + first / 4u * 3u)
+							: decode_groups<check_validity, Alphabet>(part.data(), part.length(), res + first / 4u * 3u)
+					);
+				});
+
+				for (mut<usize> i = 0u; i < chunks; ++i) {
+					if ( decoded[i] != (chunks - 1u == i ? input.length() : (i + 1u) * chunk) ) {
+						return decoded[i];
+					}
+				}
+
+				return input.length();
+			}
+
+			template<typename Alphabet, typename Run>
+			inline u8string _encode(
+				u8string_view const input,
+				usize workers,
+				Run const& run
+			) {
+				u8string return_value;
+				usize final_length = encoded_length<Alphabet>(input.length());
+
+				instrument::count_call(instrument::site::parallel_encode, input.length());
+
+				append_uninitialized_rethrow(return_value, final_length, [&](ptr<char8_t> res) -> mut<usize> {
+					_encode_into<Alphabet>(input, res, workers, run);
+
+					return final_length;
+				});
+
+				return return_value;
+			}
+
+			template<typename Alphabet, typename Run>
+			inline opt_ustring _decode(
+				u8string_view const input,
+				usize workers,
+				Run const& run
+			) {
+				auto const final_length = decoded_length<Alphabet>(input);
+
+				instrument::count_call(instrument::site::parallel_decode, input.length());
+
+				if ( !final_length ) {
+					instrument::count_rejected(instrument::site::parallel_decode);
+
+					return opt_ustring { std::nullopt };
+				}
+
+				u8string return_value;
+				mut<bool> integrity = true;
+
+				append_uninitialized_rethrow(return_value, *final_length, [&](ptr<char8_t> res) -> mut<usize> {
+					integrity = input.length() == _decode_into<true, Alphabet>(input, res, workers, run);
+
+					return *final_length;
+				});
+
+				if ( !integrity ) {
+					instrument::count_rejected(instrument::site::parallel_decode);
+
+					return opt_ustring { std::nullopt };
+				}
+
+				return std::make_optional<u8string>(
+					std::forward<u8string>(return_value)
+				);
+			}
+
+#if defined(__cpp_lib_expected)
+			// _decode_into() already knows the offset of the first bad group in all of `input`,
+			// whichever chunk it is in, so the error is found as in detail::_try_decode().
+			template<typename Alphabet, typename Run>
+			inline std::expected<u8string, decode_error> _try_decode(
+				u8string_view const input,
+				usize workers,
+				Run const& run
+			) {
+				auto const final_length = decoded_length<Alphabet>(input);
+
+				instrument::count_call(instrument::site::parallel_decode, input.length());
+
+				if ( !final_length ) {
+					instrument::count_rejected(instrument::site::parallel_decode);
+
+					return std::unexpected(decode_error { decode_error_kind::invalid_length, input.length() / 4u * 4u });
+				}
+
+				u8string return_value;
+				mut<usize> char_no = 0u;
+
+				append_uninitialized_rethrow(return_value, *final_length, [&](ptr<char8_t> res) -> mut<usize> {
+					char_no = _decode_into<true, Alphabet>(input, res, workers, run);
+
+					return *final_length;
+				});
+
+				if ( input.length() != char_no ) {
+					instrument::count_rejected(instrument::site::parallel_decode);
+
+					return std::unexpected(_decode_error_at<Alphabet>(input, char_no));
+				}
+
+				return return_value;
+			}
+#endif
+
+			template<typename Executor>
+			concept executor = std::invocable<Executor&, std::function<void()>>;
+
+			// Same results as base64::encode, computed by up to `threads` threads
+			// in chunks of at least min_chunk_length bytes.
+			template<alphabet_policy Alphabet = alphabet::standard>
+			inline u8string encode(
+				u8string_view const input,
+				usize threads = hardware_threads()
+			) {
+				return _encode<Alphabet>(input, 0u == threads ? 1u : threads, [](usize count, auto const& task) {
+					run_on_threads(count, task);
+				});
+			}
+
+			// Same, but every chunk is handed to `executor` as a std::function<void()>
+			// (e.g. posted to an existing thread pool); blocks until all of them ran.
+			template<alphabet_policy Alphabet = alphabet::standard, executor Executor>
+			inline u8string encode(
+				u8string_view const input,
+				Executor&& executor
+			) {
+				return _encode<Alphabet>(input, hardware_threads(), [&](usize count, auto const& task) {
+					run_on_executor(executor, count, task);
+				});
+			}
+
+			template<alphabet_policy Alphabet = alphabet::standard>
+			inline opt_ustring decode(
+				u8string_view const input,
+				usize threads = hardware_threads()
+			) {
+				return _decode<Alphabet>(input, 0u == threads ? 1u : threads, [](usize count, auto const& task) {
+					run_on_threads(count, task);
+				});
+			}
+
+			template<alphabet_policy Alphabet = alphabet::standard, executor Executor>
+			inline opt_ustring decode(
+				u8string_view const input,
+				Executor&& executor
+			) {
+				return _decode<Alphabet>(input, hardware_threads(), [&](usize count, auto const& task) {
+					run_on_executor(executor, count, task);
+				});
+			}
+
+#if defined(__cpp_lib_expected)
+			// Same as base64::try_decode, the offset is into all of `input` whichever chunk the error is in.
+			template<alphabet_policy Alphabet = alphabet::standard>
+			inline std::expected<u8string, decode_error> try_decode(
+				u8string_view const input,
+				usize threads = hardware_threads()
+			) {
+				return _try_decode<Alphabet>(input, 0u == threads ? 1u : threads, [](usize count, auto const& task) {
+					run_on_threads(count, task);
+				});
+			}
+
+			template<alphabet_policy Alphabet = alphabet::standard, executor Executor>
+			inline std::expected<u8string, decode_error> try_decode(
+				u8string_view const input,
+				Executor&& executor
+			) {
+				return _try_decode<Alphabet>(input, hardware_threads(), [&](usize count, auto const& task) {
+					run_on_executor(executor, count, task);
+				});
+			}
+#endif
+
+		} // namespace base64::detail::parallel
+
+	} // namespace base64::detail
+
+	// leak the public API into outer scope (base64)
+	using detail::encode;
+	using detail::decode;
+	using detail::decode_nocheck;
+	using detail::decode_skip_whitespace;
+	using detail::decode_in_place;
+#if defined(__cpp_lib_expected)
+	using detail::try_decode;
+#endif
+	using detail::decode_error;
+	using detail::decode_error_kind;
+	using detail::append_encode;
+	using detail::append_decode;
+	using detail::encoder;
+	using detail::decoder;
+	using detail::basic_encoder;
+	using detail::basic_decoder;
+	using detail::batch;
+	using detail::encode_batch;
+	using detail::decode_batch;
+	using detail::encoded_length;
+	using detail::max_decoded_length;
+	using detail::decoded_length;
+	using detail::validate;
+	using detail::alphabet_policy;
+	using detail::line_format;
+
+	namespace line {
+		using detail::line::mime;
+		using detail::line::pem;
+	}
+
+	namespace alphabet {
+		using detail::alphabet::standard;
+		using detail::alphabet::standard_unpadded;
+		using detail::alphabet::url;
+		using detail::alphabet::url_unpadded;
+		using detail::alphabet::imap;
+		using detail::alphabet::bcrypt;
+		using detail::alphabet::crypt;
+	}
+
+	namespace parallel {
+		using detail::parallel::encode;
+		using detail::parallel::decode;
+#if defined(__cpp_lib_expected)
+		using detail::parallel::try_decode;
+#endif
+	}
+
+	namespace instrument {
+		using detail::instrument::site;
+		using detail::instrument::site_count;
+		using detail::instrument::bucket_count;
+		using detail::instrument::name;
+#if defined(BASE64_INSTRUMENT)
+		using detail::instrument::site_statistics;
+		using detail::instrument::statistics;
+		using detail::instrument::snapshot;
+#endif
+	}
 
 } // namespace base64
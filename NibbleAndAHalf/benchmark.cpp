@@ -0,0 +1,707 @@
+//
+//  benchmark.cpp
+//  NibbleAndAHalf
+//
+//  Throughput of base64.hpp over a sweep of sizes, for catching regressions.
+//
+//    g++ -std=c++20 -O2 benchmark.cpp -o benchmark -pthread
+//    ./benchmark [--min BYTES] [--max BYTES] [--samples N] [--filter TEXT] [--format table|csv|json] [--counters]
+//
+//  Every case is warmed up, then timed `--samples` times; each sample repeats the call
+//  until it has run for at least a millisecond, so that even 8 byte calls are measured
+//  well above the resolution of the clock. The median, 10th and 90th percentile of the
+//  samples are reported as GB/s (of input, 10^9 bytes per second) and cycles per byte
+//  (of the time stamp counter, where there is one). Samples are timed with the
+//  serialized time stamp counter of Timer.h, or steady_clock where it is not usable.
+//
+//  --counters also reads hardware counters around every sample with Linux perf_event_open
+//  (core cycles, instructions, branch misses, L1 data cache misses and last level cache misses)
+//  and adds the medians of IPC, instructions and branch misses per byte, and cache misses
+//  per call. Counters the kernel, the CPU or the container don't provide read as n/a
+//  (empty in CSV, null in JSON); the timings are the same either way.
+//
+
+#include "base64.hpp"
+#include "Timer.h"
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	using namespace base64::detail;
+	using namespace base64::kernels;
+
+	enum event : unsigned {
+		core_cycles,
+		instructions,
+		branch_misses,
+		l1d_misses,
+		cache_misses,
+		event_count
+	};
+
+	constexpr char const* event_names[event_count] {
+		"cycles", "instructions", "branch-misses", "L1-dcache-load-misses", "cache-misses"
+	};
+
+	constexpr double not_counted = std::numeric_limits<double>::quiet_NaN();
+
+	// Counts of the calling thread in user space, one perf_event_open() file per event, so that
+	// one missing event leaves the others working. Each is scaled by enabled / running time in case
+	// the kernel had to multiplex them. Where there is no perf_event_open every count is not_counted.
+	class perf_counters {
+#if defined(__linux__)
+		int files[event_count];
+		std::string reasons[event_count];
+
+		static int open_event(
+			std::uint32_t const type,
+			std::uint64_t const config
+		) noexcept {
+			perf_event_attr attributes;
+
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = type;
+			attributes.config = config;
+			attributes.disabled = 1u;
+			attributes.exclude_kernel = 1u;
+			attributes.exclude_hv = 1u;
+			attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0ul));
+		}
+
+	public:
+		perf_counters() {
+			open(core_cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+			open(instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+			open(branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+			open(l1d_misses, PERF_TYPE_HW_CACHE,
+				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8u) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16u));
+			open(cache_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		}
+
+		// Opens `which`, or notes why it could not be opened.
+		void open(
+			event const which,
+			std::uint32_t const type,
+			std::uint64_t const config
+		) {
+			files[which] = open_event(type, config);
+
+			if ( 0 > files[which] ) {
+				int const error = errno;
+
+				reasons[which] = std::string("perf_event_open: ") + std::strerror(error);
+
+				if ( EACCES == error || EPERM == error ) {
+					reasons[which] += "; see kernel.perf_event_paranoid, or the seccomp profile of the container";
+				} else if ( ENOENT == error || EOPNOTSUPP == error || ENODEV == error ) {
+					reasons[which] += "; the CPU or the hypervisor has no such counter";
+				}
+			}
+		}
+
+		perf_counters(perf_counters const&) = delete;
+		perf_counters& operator=(perf_counters const&) = delete;
+
+		~perf_counters() {
+			for (int const file : files) {
+				if ( 0 <= file ) {
+					close(file);
+				}
+			}
+		}
+
+		bool available(
+			event const which
+		) const noexcept {
+			return 0 <= files[which];
+		}
+
+		std::string const& reason(
+			event const which
+		) const noexcept {
+			return reasons[which];
+		}
+
+		void start() noexcept {
+			for (int const file : files) {
+				if ( 0 <= file ) {
+					ioctl(file, PERF_EVENT_IOC_RESET, 0);
+					ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+		}
+
+		void stop(
+			double (&counts)[event_count]
+		) noexcept {
+			for (int const file : files) {
+				if ( 0 <= file ) {
+					ioctl(file, PERF_EVENT_IOC_DISABLE, 0);
+				}
+			}
+
+			for (mut<unsigned> which = 0u; which < event_count; ++which) {
+				// value, time enabled, time running
+				std::uint64_t values[3u];
+
+				counts[which] = not_counted;
+
+				if ( 0 > files[which] || sizeof(values) != read(files[which], values, sizeof(values)) || 0u == values[2u] ) {
+					continue;
+				}
+
+				counts[which] = static_cast<double>(values[0u]) * static_cast<double>(values[1u]) / static_cast<double>(values[2u]);
+			}
+		}
+#else
+	public:
+		bool available(
+			event const
+		) const noexcept {
+			return false;
+		}
+
+		std::string reason(
+			event const
+		) const {
+			return "no perf_event_open on this system";
+		}
+
+		void start() noexcept {
+		}
+
+		void stop(
+			double (&counts)[event_count]
+		) noexcept {
+			std::fill(std::begin(counts), std::end(counts), not_counted);
+		}
+#endif
+	};
+
+	struct sample {
+		double seconds;
+		double cycles;
+		double events[event_count];
+	};
+
+	struct result {
+		std::string name;
+		mut<usize> size;
+		mut<usize> repetitions;
+		// per call, over the samples: 10th percentile, median, 90th percentile
+		double seconds[3];
+		double cycles[3];
+		// per call, medians; not_counted without --counters
+		double events[event_count];
+	};
+
+	double percentile(
+		std::vector<double> values,
+		double const fraction
+	) {
+		std::sort(values.begin(), values.end());
+
+		double const position = fraction * static_cast<double>(values.size() - 1u);
+		usize below = static_cast<mut<usize>>(position);
+		usize above = std::min(below + 1u, values.size() - 1u);
+
+		return values[below] + (position - static_cast<double>(below)) * (values[above] - values[below]);
+	}
+
+	// One function under test, run on `size` bytes (or characters) of input.
+	struct benchmark_case {
+		std::string name;
+		std::function<void(usize)> run;
+	};
+
+	// Times `repetitions` calls in a row as one lap, returns the time (and the counts) per call.
+	// The counters are enabled outside of the timer, so their ioctl()s are not timed.
+	template<typename Clock>
+	sample measure_with(
+		benchmark_case const& test,
+		usize size,
+		usize repetitions,
+		perf_counters* const counters
+	) {
+		base64::timing::basic_timer<Clock> timer;
+		mut<sample> timed;
+
+		std::fill(std::begin(timed.events), std::end(timed.events), not_counted);
+
+		if ( nullptr != counters ) {
+			counters->start();
+		}
+
+		timer.start();
+
+		for (mut<usize> i = 0u; i < repetitions; ++i) {
+			test.run(size);
+		}
+
+		timer.stop();
+
+		if ( nullptr != counters ) {
+			counters->stop(timed.events);
+		}
+
+		timed.seconds = timer.seconds() / static_cast<double>(repetitions);
+		timed.cycles = timer.cycles() / static_cast<double>(repetitions);
+
+		for (double& count : timed.events) {
+			count /= static_cast<double>(repetitions);
+		}
+
+		return timed;
+	}
+
+	// The serialized time stamp counter where it is usable, steady_clock otherwise.
+	sample measure(
+		benchmark_case const& test,
+		usize size,
+		usize repetitions,
+		perf_counters* const counters = nullptr
+	) {
+#if BASE64_TIMER_TSC
+		if ( base64::timing::tsc_clock::available() ) {
+			return measure_with<base64::timing::tsc_clock>(test, size, repetitions, counters);
+		}
+#endif
+
+		return measure_with<base64::timing::steady_clock>(test, size, repetitions, counters);
+	}
+
+	result run_case(
+		benchmark_case const& test,
+		usize size,
+		usize samples,
+		perf_counters* const counters
+	) {
+		constexpr double minimum_seconds = 1e-3;
+
+		// warm-up, which also finds how many calls make up a sample
+		mut<usize> repetitions = 1u;
+
+		for (;;) {
+			sample const warm = measure(test, size, repetitions);
+
+			if ( warm.seconds * static_cast<double>(repetitions) >= minimum_seconds ) {
+				break;
+			}
+
+			repetitions *= 2u;
+		}
+
+		std::vector<double> seconds;
+		std::vector<double> cycle_counts;
+		std::vector<double> event_counts[event_count];
+
+		for (mut<usize> i = 0u; i < samples; ++i) {
+			sample const timed = measure(test, size, repetitions, counters);
+
+			seconds.push_back(timed.seconds);
+			cycle_counts.push_back(timed.cycles);
+
+			for (mut<unsigned> which = 0u; which < event_count; ++which) {
+				event_counts[which].push_back(timed.events[which]);
+			}
+		}
+
+		mut<result> timed {
+			test.name,
+			size,
+			repetitions,
+			{ percentile(seconds, 0.1), percentile(seconds, 0.5), percentile(seconds, 0.9) },
+			{ percentile(cycle_counts, 0.1), percentile(cycle_counts, 0.5), percentile(cycle_counts, 0.9) },
+			{}
+		};
+
+		for (mut<unsigned> which = 0u; which < event_count; ++which) {
+			// a sample that could not be counted makes the whole median not_counted
+			auto const& counts = event_counts[which];
+
+			timed.events[which] = std::any_of(counts.begin(), counts.end(), [](double count) { return std::isnan(count); })
+				? not_counted
+				: percentile(counts, 0.5);
+		}
+
+		return timed;
+	}
+
+	// Buffers shared by every case, sized for the largest input.
+	struct buffers {
+		u8string binary;
+		u8string text;
+		u8string output;
+	};
+
+	// Keeps the compiler from dropping a call whose result is never used.
+	template<typename T>
+	inline void keep(
+		T const& value
+	) noexcept {
+		asm volatile("" : : "r"(&value) : "memory");
+	}
+
+	std::vector<benchmark_case> make_cases(
+		buffers& data
+	) {
+		using standard = base64::alphabet::standard;
+
+		auto const binary = [&](usize size) { return u8string_view(data.binary.data(), size); };
+		// whole groups from the front of a longer encoding, so never any padding
+		auto const text = [&](usize size) { return u8string_view(data.text.data(), size / 4u * 4u); };
+		auto const output = [&] { return std::span<char8_t>(data.output); };
+
+		std::vector<benchmark_case> cases {
+			{ "encode", [=](usize size) { keep(base64::encode(binary(size), output())); } },
+			{ "decode", [=](usize size) { keep(base64::decode(text(size), output())); } },
+			{ "decode_nocheck", [=](usize size) { keep(base64::decode_nocheck(text(size), output())); } },
+			{ "validate", [=](usize size) { keep(base64::validate(text(size))); } },
+		};
+
+		// Every kernel on its own, including the ones the dispatch passes over on this CPU.
+		for (auto const& kernel : encode_kernels<standard>()) {
+			cases.push_back({ kernel.name, [=, run = kernel.kernel](usize size) {
+				keep(run(binary(size).data(), size, output().data()));
+			} });
+		}
+
+		// The input split into lane_count inputs side by side, whole groups only.
+		for (auto const& kernel : encode_lanes_kernels<standard>()) {
+			cases.push_back({ kernel.name, [=, run = kernel.kernel](usize size) {
+				usize groups = size / lane_count / 3u;
+				mut<u8*> lane_data[lane_count];
+				mut<char8_t*> lane_res[lane_count];
+
+				for (mut<usize> lane = 0u; lane < lane_count; ++lane) {
+					lane_data[lane] = binary(size).data() + lane * 3u * groups;
+					lane_res[lane] = output().data() + lane * 4u * groups;
+				}
+
+				run(lane_data, lane_res, groups);
+				keep(lane_res);
+			} });
+		}
+
+		for (auto const& kernel : decode_kernels<true, standard>()) {
+			cases.push_back({ kernel.name, [=, run = kernel.kernel](usize size) {
+				keep(run(text(size).data(), text(size).length(), output().data()));
+			} });
+		}
+
+		for (auto const& kernel : decode_kernels<false, standard>()) {
+			cases.push_back({ kernel.name, [=, run = kernel.kernel](usize size) {
+				keep(run(text(size).data(), text(size).length(), output().data()));
+			} });
+		}
+
+		for (auto const& kernel : validate_kernels<standard>()) {
+			cases.push_back({ kernel.name, [=, run = kernel.kernel](usize size) {
+				keep(run(text(size).data(), text(size).length()));
+			} });
+		}
+
+		return cases;
+	}
+
+	enum class format {
+		table,
+		csv,
+		json
+	};
+
+	// What --counters adds to every result, derived from the medians per call.
+	enum metric : unsigned {
+		ipc,
+		instructions_per_byte,
+		branch_misses_per_byte,
+		l1d_misses_per_call,
+		cache_misses_per_call,
+		metric_count
+	};
+
+	constexpr char const* metric_names[metric_count] {
+		"ipc", "instructions_per_byte", "branch_misses_per_byte", "l1d_misses_per_call", "cache_misses_per_call"
+	};
+
+	void derive_metrics(
+		result const& timed,
+		double (&metrics)[metric_count]
+	) noexcept {
+		double const bytes = static_cast<double>(std::max<mut<usize>>(timed.size, 1u));
+
+		// NaN stays NaN through all of these
+		metrics[ipc] = timed.events[instructions] / timed.events[core_cycles];
+		metrics[instructions_per_byte] = timed.events[instructions] / bytes;
+		metrics[branch_misses_per_byte] = timed.events[branch_misses] / bytes;
+		metrics[l1d_misses_per_call] = timed.events[l1d_misses];
+		metrics[cache_misses_per_call] = timed.events[cache_misses];
+	}
+
+	void print_header(
+		format const style,
+		bool const counters
+	) {
+		if ( format::table == style ) {
+			std::printf("%-21s %12s %10s %10s %10s %10s %10s",
+				"case", "bytes", "GB/s p50", "GB/s p10", "GB/s p90", "cyc/B p50", "ns/call");
+
+			if ( counters ) {
+				std::printf(" %7s %8s %9s %10s %10s", "IPC", "ins/B", "brmiss/B", "L1Dmiss", "LLCmiss");
+			}
+
+			std::printf("\n");
+		} else if ( format::csv == style ) {
+			std::printf("case,bytes,repetitions,seconds_p10,seconds_p50,seconds_p90,cycles_p10,cycles_p50,cycles_p90,gbps_p50,cycles_per_byte_p50");
+
+			if ( counters ) {
+				for (char const* const name : metric_names) {
+					std::printf(",%s", name);
+				}
+			}
+
+			std::printf("\n");
+		} else {
+			std::printf("[\n");
+		}
+	}
+
+	void print_metrics(
+		format const style,
+		result const& timed
+	) {
+		double metrics[metric_count];
+
+		derive_metrics(timed, metrics);
+
+		for (mut<unsigned> which = 0u; which < metric_count; ++which) {
+			double const value = metrics[which];
+			bool const counted = !std::isnan(value);
+
+			if ( format::table == style ) {
+				static constexpr int widths[metric_count] { 7, 8, 9, 10, 10 };
+
+				if ( counted ) {
+					std::printf(" %*.*f", widths[which], which <= branch_misses_per_byte ? 3 : 1, value);
+				} else {
+					std::printf(" %*s", widths[which], "n/a");
+				}
+			} else if ( format::csv == style ) {
+				if ( counted ) {
+					std::printf(",%.6g", value);
+				} else {
+					std::printf(",");
+				}
+			} else {
+				std::printf("%s\"%s\": ", 0u == which ? "" : ", ", metric_names[which]);
+
+				if ( counted ) {
+					std::printf("%.6g", value);
+				} else {
+					std::printf("null");
+				}
+			}
+		}
+	}
+
+	void print_result(
+		format const style,
+		result const& timed,
+		bool const first,
+		bool const counters
+	) {
+		double const bytes = static_cast<double>(std::max<mut<usize>>(timed.size, 1u));
+		// the fastest sample (10th percentile of the time) is the 90th percentile of the throughput
+		double const gbps[3] = { bytes / timed.seconds[2] / 1e9, bytes / timed.seconds[1] / 1e9, bytes / timed.seconds[0] / 1e9 };
+
+		if ( format::table == style ) {
+			std::printf("%-21s %12zu %10.3f %10.3f %10.3f %10.3f %10.1f",
+				timed.name.c_str(), timed.size, gbps[1], gbps[0], gbps[2], timed.cycles[1] / bytes, timed.seconds[1] * 1e9);
+		} else if ( format::csv == style ) {
+			std::printf("%s,%zu,%zu,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.6g,%.6g",
+				timed.name.c_str(), timed.size, timed.repetitions,
+				timed.seconds[0], timed.seconds[1], timed.seconds[2],
+				timed.cycles[0], timed.cycles[1], timed.cycles[2],
+				gbps[1], timed.cycles[1] / bytes);
+		} else {
+			std::printf("%s  {\"case\": \"%s\", \"bytes\": %zu, \"repetitions\": %zu, "
+				"\"seconds\": {\"p10\": %.9g, \"p50\": %.9g, \"p90\": %.9g}, "
+				"\"cycles\": {\"p10\": %.9g, \"p50\": %.9g, \"p90\": %.9g}, "
+				"\"gbps_p50\": %.6g, \"cycles_per_byte_p50\": %.6g",
+				first ? "" : ",\n",
+				timed.name.c_str(), timed.size, timed.repetitions,
+				timed.seconds[0], timed.seconds[1], timed.seconds[2],
+				timed.cycles[0], timed.cycles[1], timed.cycles[2],
+				gbps[1], timed.cycles[1] / bytes);
+		}
+
+		if ( counters ) {
+			if ( format::json == style ) {
+				std::printf(", \"counters\": {");
+			}
+
+			print_metrics(style, timed);
+
+			if ( format::json == style ) {
+				std::printf("}");
+			}
+		}
+
+		std::printf(format::json == style ? "}" : "\n");
+
+		std::fflush(stdout);
+	}
+
+	[[noreturn]] void usage(
+		char const* const program
+	) {
+		std::fprintf(stderr,
+			"usage: %s [--min BYTES] [--max BYTES] [--samples N] [--filter TEXT] [--format table|csv|json] [--counters]\n"
+			"  sizes go from --min (8) to --max (1073741824) in powers of 2\n"
+			"  --filter runs only the cases whose name contains TEXT\n"
+			"  --counters adds IPC, instructions and branch misses per byte and cache misses per call (Linux)\n",
+			program);
+		std::exit(2);
+	}
+
+} // namespace
+
+int main(
+	int const argc,
+	char** const argv
+) {
+	mut<usize> min_size = 8u;
+	mut<usize> max_size = 1u << 30u;
+	mut<usize> samples = 15u;
+	std::string_view filter;
+	mut<format> style = format::table;
+	mut<bool> counters = false;
+
+	for (mut<int> i = 1; i < argc; ++i) {
+		std::string_view const option = argv[i];
+
+		if ( "--counters" == option ) {
+			counters = true;
+
+			continue;
+		}
+
+		if ( i + 1 >= argc ) {
+			usage(argv[0]);
+		}
+
+		std::string_view const value = argv[++i];
+
+		if ( "--min" == option ) {
+			min_size = std::max<mut<usize>>(std::strtoull(value.data(), nullptr, 0), 1u);
+		} else if ( "--max" == option ) {
+			max_size = std::strtoull(value.data(), nullptr, 0);
+		} else if ( "--samples" == option ) {
+			samples = std::max<mut<usize>>(std::strtoull(value.data(), nullptr, 0), 1u);
+		} else if ( "--filter" == option ) {
+			filter = value;
+		} else if ( "--format" == option ) {
+			if ( "table" == value ) {
+				style = format::table;
+			} else if ( "csv" == value ) {
+				style = format::csv;
+			} else if ( "json" == value ) {
+				style = format::json;
+			} else {
+				usage(argv[0]);
+			}
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	buffers data;
+
+	// random input, so that the character distribution is the one of real binary data
+	{
+		std::mt19937_64 random(0x6E6962626C65ull);
+
+		data.binary.resize(max_size);
+
+		for (auto& byte : data.binary) {
+			byte = static_cast<char8_t>(random());
+		}
+
+		data.text = base64::encode(data.binary);
+		data.output.resize(encoded_length(max_size));
+	}
+
+	std::vector<benchmark_case> const cases = make_cases(data);
+
+	// opened once, before anything is printed, so that the warnings go ahead of the results
+	std::optional<perf_counters> hardware;
+
+	if ( counters ) {
+		hardware.emplace();
+
+		mut<unsigned> missing = 0u;
+
+		for (mut<unsigned> which = 0u; which < event_count; ++which) {
+			missing += hardware->available(static_cast<event>(which)) ? 0u : 1u;
+		}
+
+		if ( event_count == missing ) {
+			// typically a container or a virtual machine, one line is enough
+			std::fprintf(stderr, "%s: no hardware counters (%s), reported as n/a\n",
+				argv[0], hardware->reason(core_cycles).c_str());
+		} else {
+			for (mut<unsigned> which = 0u; which < event_count; ++which) {
+				if ( !hardware->available(static_cast<event>(which)) ) {
+					std::fprintf(stderr, "%s: %s is not counted (%s), reported as n/a\n",
+						argv[0], event_names[which], hardware->reason(static_cast<event>(which)).c_str());
+				}
+			}
+		}
+	}
+
+	print_header(style, counters);
+
+	mut<bool> first = true;
+
+	for (auto const& test : cases) {
+		if ( std::string_view::npos == test.name.find(filter) ) {
+			continue;
+		}
+
+		for (mut<usize> size = min_size; size <= max_size; size *= 2u) {
+			print_result(style, run_case(test, size, samples, hardware ? &*hardware : nullptr), first, counters);
+			first = false;
+		}
+	}
+
+	if ( format::json == style ) {
+		std::printf("\n]\n");
+	}
+
+	return 0;
+}
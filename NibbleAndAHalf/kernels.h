@@ -0,0 +1,110 @@
+//
+//  kernels.h
+//  NibbleAndAHalf
+//
+//  Every kernel of base64.hpp of each kind that this CPU can run, by the names the instrument
+//  counters use ("encode/avx2", "decode_nocheck/ssse3", ...), so that test.cpp can check each
+//  of them and benchmark.cpp can time each of them, not only the one the dispatch picks.
+//
+//    for (auto const& [name, kernel] : base64::kernels::decode_kernels<true, base64::alphabet::standard>()) {
+//        kernel(text, length, output);
+//    }
+//
+
+#pragma once
+
+#include "base64.hpp"
+
+#include <string>
+#include <vector>
+
+namespace base64::kernels {
+
+	template<typename Kernel>
+	struct named {
+		std::string name;
+		Kernel kernel;
+	};
+
+	template<typename Alphabet>
+	std::vector<named<detail::encode_kernel>> encode_kernels() {
+		std::vector<named<detail::encode_kernel>> kernels { { "encode/scalar", detail::encode_groups_scalar<Alphabet> } };
+
+#if BASE64_X86_SIMD
+		__builtin_cpu_init();
+
+		if ( __builtin_cpu_supports("avx2") ) {
+			kernels.push_back({ "encode/avx2", detail::avx2::encode_groups<Alphabet> });
+		}
+
+		if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+			kernels.push_back({ "encode/avx512", detail::avx512::encode_groups<Alphabet> });
+		}
+#endif
+
+		return kernels;
+	}
+
+	template<typename Alphabet>
+	std::vector<named<detail::encode_lanes_kernel>> encode_lanes_kernels() {
+		std::vector<named<detail::encode_lanes_kernel>> kernels { { "encode_lanes/scalar", detail::encode_lanes_scalar<Alphabet> } };
+
+#if BASE64_X86_SIMD
+		__builtin_cpu_init();
+
+		if ( __builtin_cpu_supports("avx2") ) {
+			kernels.push_back({ "encode_lanes/avx2", detail::avx2::encode_lanes<Alphabet> });
+		}
+#endif
+
+		return kernels;
+	}
+
+	template<bool const check_validity, typename Alphabet>
+	std::vector<named<detail::decode_kernel>> decode_kernels() {
+		std::string const kind = check_validity ? "decode/" : "decode_nocheck/";
+		std::vector<named<detail::decode_kernel>> kernels { { kind + "scalar", detail::decode_groups_scalar<check_validity, Alphabet> } };
+
+#if BASE64_X86_SIMD
+		__builtin_cpu_init();
+
+		if ( __builtin_cpu_supports("ssse3") ) {
+			kernels.push_back({ kind + "ssse3", detail::ssse3::decode_groups<check_validity, Alphabet> });
+		}
+
+		if ( __builtin_cpu_supports("avx2") ) {
+			kernels.push_back({ kind + "avx2", detail::avx2::decode_groups<check_validity, Alphabet> });
+		}
+
+		if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+			kernels.push_back({ kind + "avx512", detail::avx512::decode_groups<check_validity, Alphabet> });
+		}
+#endif
+
+		return kernels;
+	}
+
+	template<typename Alphabet>
+	std::vector<named<detail::validate_kernel>> validate_kernels() {
+		std::vector<named<detail::validate_kernel>> kernels { { "validate/scalar", detail::all_in_alphabet_scalar<Alphabet> } };
+
+#if BASE64_X86_SIMD
+		__builtin_cpu_init();
+
+		if ( __builtin_cpu_supports("ssse3") ) {
+			kernels.push_back({ "validate/ssse3", detail::ssse3::all_in_alphabet<Alphabet> });
+		}
+
+		if ( __builtin_cpu_supports("avx2") ) {
+			kernels.push_back({ "validate/avx2", detail::avx2::all_in_alphabet<Alphabet> });
+		}
+
+		if ( __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw") ) {
+			kernels.push_back({ "validate/avx512", detail::avx512::all_in_alphabet<Alphabet> });
+		}
+#endif
+
+		return kernels;
+	}
+
+} // namespace base64::kernels
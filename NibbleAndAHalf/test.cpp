@@ -0,0 +1,1518 @@
+//
+//  test.cpp
+//  NibbleAndAHalf
+//
+//  Correctness tests for base64.hpp. Every kernel this CPU can run is called directly and
+//  compared against a reference that decodes one character at a time, for every length up
+//  to a few hundred bytes and around the edges of the 16 to 64 byte blocks of the vector
+//  kernels, on valid input and with one invalid character at every position. The entry points
+//  that carry groups over between calls or fragments (encoder / decoder, fragments) get the same
+//  input cut into pieces of every size, decode_skip_whitespace with whitespace between the pieces,
+//  and try_decode the same errors, for their offsets.
+//
+//    g++ -std=c++20 -O2 test.cpp -o test -pthread && ./test
+//
+//  The header builds different kernels depending on its configuration, so run the tests
+//  once for each of them, with BASE64_INSTRUMENT for the counters, and as C++23 for try_decode:
+//
+//    g++ -std=c++20 -O2 -DBASE64_NO_SIMD test.cpp -o test -pthread && ./test
+//    g++ -std=c++20 -O2 -DBASE64_ENCODE_PAIRS test.cpp -o test -pthread && ./test
+//    g++ -std=c++20 -O2 -DBASE64_INSTRUMENT test.cpp -o test -pthread && ./test
+//    g++ -std=c++23 -O2 test.cpp -o test -pthread && ./test
+//
+//  Every failed check is printed (up to a limit) and the exit status is 1 if any failed.
+//
+
+#include "base64.hpp"
+#include "kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	using namespace base64::detail;
+	using namespace base64::kernels;
+
+	// The standard alphabet backwards, with '!' and '#' for sextets 62 and 63. It fits neither the
+	// range tricks of the AVX2 encoder nor the nibble tables of the SSSE3 / AVX2 decoders,
+	// so those kernels fall back on their 16-characters-at-a-time lookups.
+	struct scrambled {
+		static constexpr u8 characters[] =
+			u8"zyxwvutsrqponmlkjihgfedcba"
+			"ZYXWVUTSRQPONMLKJIHGFEDCBA"
+			"9876543210!#";
+		static constexpr bool padded = true;
+	};
+
+	static_assert( alphabet_policy<scrambled> );
+	static_assert( !encode_ranges_of<scrambled>.fits && !decode_nibbles_of<scrambled>.fits );
+
+	// The test vectors of RFC 4648 section 10, run at compile time through the fixed size
+	// overloads and through the constexpr ones for any length.
+	template<mut<usize> length>
+	consteval bool fixed_size_round_trips(
+		u8string_view const text
+	) {
+		std::array<std::byte, length> bytes;
+
+		for (mut<usize> i = 0u; i < length; ++i) {
+			bytes[i] = std::byte { u8"foobar"[i] };
+		}
+
+		auto const encoded = base64::encode<length>(std::span<std::byte const, length>(bytes));
+
+		return text == u8string_view(encoded.data(), encoded.size()) && base64::decode<length>(text) == bytes;
+	}
+
+	consteval bool round_trips(
+		u8string_view const bytes,
+		u8string_view const text
+	) {
+		u8string appended = u8"x";
+		u8string decoded = u8"y";
+
+		base64::append_encode(appended, bytes);
+		base64::append_decode(decoded, text);
+
+		return base64::encode(bytes) == text
+			&& base64::decode(text) == bytes
+			&& base64::decode_nocheck(text) == bytes
+			&& u8"x" + u8string(text) == appended
+			&& u8"y" + u8string(bytes) == decoded;
+	}
+
+	static_assert( fixed_size_round_trips<0u>(u8"") );
+	static_assert( fixed_size_round_trips<1u>(u8"Zg==") );
+	static_assert( fixed_size_round_trips<2u>(u8"Zm8=") );
+	static_assert( fixed_size_round_trips<3u>(u8"Zm9v") );
+	static_assert( fixed_size_round_trips<4u>(u8"Zm9vYg==") );
+	static_assert( fixed_size_round_trips<5u>(u8"Zm9vYmE=") );
+	static_assert( fixed_size_round_trips<6u>(u8"Zm9vYmFy") );
+
+	static_assert( round_trips(u8"f", u8"Zg==") );
+	static_assert( round_trips(u8"fo", u8"Zm8=") );
+	static_assert( round_trips(u8"foo", u8"Zm9v") );
+	static_assert( round_trips(u8"foob", u8"Zm9vYg==") );
+	static_assert( round_trips(u8"fooba", u8"Zm9vYmE=") );
+	static_assert( round_trips(u8"foobar", u8"Zm9vYmFy") );
+
+	static_assert( !base64::decode(u8"").has_value() );
+	static_assert( !base64::decode(u8"Zm=v").has_value() && !base64::decode(u8"Zm9vY").has_value() && !base64::decode(u8"Zm!v").has_value() );
+	static_assert( !base64::decode<1u>(u8"Zg=A").has_value() && !base64::decode<3u>(u8"Zm9").has_value() );
+	static_assert( u8"-_8" == base64::encode<alphabet::url_unpadded>(u8"\xFB\xFF") );
+	static_assert( 6u == base64::decode<*base64::decoded_length(u8"Zm9vYmFy")>(u8"Zm9vYmFy")->size() );
+
+	// A std::span of dynamic extent has no fixed size to pick.
+	template<typename Span>
+	concept fixed_size_encodable = requires (Span input) { base64::encode(input); };
+
+	static_assert( fixed_size_encodable<std::span<std::byte const, 16u>> );
+	static_assert( !fixed_size_encodable<std::span<std::byte const>> );
+
+	constexpr usize max_reported = 20u;
+
+	mut<usize> checks = 0u;
+	mut<usize> failures = 0u;
+
+	// Counts a check and prints it if it failed, with the case it failed on.
+	bool expect(
+		bool const passed,
+		std::string_view const test,
+		std::string_view const what,
+		usize length,
+		usize at = ~usize { 0u }
+	) {
+		++checks;
+
+		if ( passed ) {
+			return true;
+		}
+
+		if ( ++failures <= max_reported ) {
+			std::printf("FAIL %.*s: %.*s, length %zu", static_cast<int>(test.size()), test.data(),
+				static_cast<int>(what.size()), what.data(), length);
+
+			if ( ~usize { 0u } != at ) {
+				std::printf(", at %zu", at);
+			}
+
+			std::printf("\n");
+		}
+
+		return false;
+	}
+
+	std::mt19937_64 random_engine(0x0B64u);
+
+	std::vector<char8_t> random_bytes(
+		usize length
+	) {
+		std::vector<char8_t> bytes(length);
+
+		for (auto& byte : bytes) {
+			byte = static_cast<char8_t>(random_engine());
+		}
+
+		return bytes;
+	}
+
+	// `length` characters picked at random from the alphabet.
+	template<typename Alphabet>
+	std::vector<char8_t> random_text(
+		usize length
+	) {
+		std::vector<char8_t> text(length);
+
+		for (auto& character : text) {
+			character = Alphabet::characters[random_engine() % 64u];
+		}
+
+		return text;
+	}
+
+	// The reference: one sextet at a time, the alphabet searched character by character
+	// (once, for a table of its own) rather than through any of the tables of the header.
+	template<typename Alphabet>
+	int sextet_of(
+		char8_t const character
+	) noexcept {
+		static std::array<int, 0x100> const sextets = [] {
+			std::array<int, 0x100> table;
+
+			table.fill(-1);
+
+			for (mut<int> i = 0; i < 64; ++i) {
+				table[Alphabet::characters[i]] = i;
+			}
+
+			return table;
+		}();
+
+		return sextets[character];
+	}
+
+	// Whole groups only, like the kernels.
+	template<typename Alphabet>
+	std::vector<char8_t> reference_encode(
+		std::vector<char8_t> const& bytes
+	) {
+		std::vector<char8_t> text;
+
+		for (mut<usize> i = 0u; i + 3u <= bytes.size(); i += 3u) {
+			mut<unsigned> bits = 0u;
+
+			for (mut<usize> j = 0u; j < 3u; ++j) {
+				bits = bits << 8u | bytes[i + j];
+			}
+
+			for (mut<int> shift = 18; 0 <= shift; shift -= 6) {
+				text.push_back(Alphabet::characters[bits >> shift & 0x3Fu]);
+			}
+		}
+
+		return text;
+	}
+
+	// Whole groups only; a character outside of the alphabet decodes as sextet 0, like decode_nocheck.
+	template<typename Alphabet>
+	std::vector<char8_t> reference_decode(
+		ptr<u8> text,
+		usize length
+	) {
+		std::vector<char8_t> bytes;
+
+		for (mut<usize> i = 0u; i + 4u <= length; i += 4u) {
+			mut<unsigned> bits = 0u;
+
+			for (mut<usize> j = 0u; j < 4u; ++j) {
+				bits = bits << 6u | static_cast<unsigned>(std::max(sextet_of<Alphabet>(text[i + j]), 0));
+			}
+
+			for (mut<int> shift = 16; 0 <= shift; shift -= 8) {
+				bytes.push_back(static_cast<char8_t>(bits >> shift));
+			}
+		}
+
+		return bytes;
+	}
+
+	// Every length up to `all_up_to`, then the lengths within `around` of each multiple
+	// of a block size of the kernels, up to `up_to`.
+	std::vector<mut<usize>> block_lengths(
+		usize all_up_to,
+		usize up_to,
+		usize around
+	) {
+		std::vector<mut<usize>> lengths;
+
+		for (mut<usize> length = 0u; length <= all_up_to; ++length) {
+			lengths.push_back(length);
+		}
+
+		for (usize block : { 16u, 24u, 32u, 48u, 64u }) {
+			for (mut<usize> edge = block; edge <= up_to; edge += block) {
+				for (mut<usize> length = edge - std::min(edge, around); length <= edge + around; ++length) {
+					lengths.push_back(length);
+				}
+			}
+		}
+
+		std::sort(lengths.begin(), lengths.end());
+		lengths.erase(std::unique(lengths.begin(), lengths.end()), lengths.end());
+
+		return lengths;
+	}
+
+	// Written past the end of the result, where no kernel may store anything.
+	constexpr char8_t guard = 0xA5u;
+	constexpr usize guard_length = 64u;
+
+	bool guard_intact(
+		std::vector<char8_t> const& output,
+		usize result_length
+	) {
+		return std::all_of(output.begin() + static_cast<std::ptrdiff_t>(result_length), output.end(), [](char8_t byte) {
+			return guard == byte;
+		});
+	}
+
+	template<typename Alphabet>
+	void test_encode_kernels(
+		std::string const& suffix
+	) {
+		auto const kernels = encode_kernels<Alphabet>();
+
+		for (usize length : block_lengths(320u, 2048u, 8u)) {
+			// exactly `length` bytes on the heap, so a sanitizer catches reads past the end
+			std::vector<char8_t> const bytes = random_bytes(length);
+			std::vector<char8_t> const expected = reference_encode<Alphabet>(bytes);
+
+			for (auto const& [name, kernel] : kernels) {
+				std::vector<char8_t> output(expected.size() + guard_length, guard);
+				usize consumed = kernel(bytes.data(), length, output.data());
+
+				expect(length / 3u * 3u == consumed, name + suffix, "consumes every whole group", length)
+					&& expect(std::equal(expected.begin(), expected.end(), output.begin()), name + suffix, "matches the reference", length)
+					&& expect(guard_intact(output, expected.size()), name + suffix, "writes nothing past the result", length);
+			}
+		}
+	}
+
+	template<typename Alphabet>
+	void test_encode_lanes_kernels(
+		std::string const& suffix
+	) {
+		for (auto const& [name, kernel] : encode_lanes_kernels<Alphabet>()) {
+			for (mut<usize> groups = 0u; groups <= 16u; ++groups) {
+				std::vector<char8_t> inputs[lane_count];
+				std::vector<char8_t> outputs[lane_count];
+				mut<u8*> data[lane_count];
+				mut<char8_t*> res[lane_count];
+
+				for (mut<usize> lane = 0u; lane < lane_count; ++lane) {
+					inputs[lane] = random_bytes(3u * groups);
+					outputs[lane].assign(4u * groups + guard_length, guard);
+					data[lane] = inputs[lane].data();
+					res[lane] = outputs[lane].data();
+				}
+
+				kernel(data, res, groups);
+
+				for (mut<usize> lane = 0u; lane < lane_count; ++lane) {
+					std::vector<char8_t> const expected = reference_encode<Alphabet>(inputs[lane]);
+
+					expect(std::equal(expected.begin(), expected.end(), outputs[lane].begin()), name + suffix, "matches the reference", 3u * groups, lane)
+						&& expect(guard_intact(outputs[lane], expected.size()), name + suffix, "writes nothing past the result", 3u * groups, lane);
+				}
+			}
+		}
+	}
+
+	// Characters that are not in the alphabet: padding, whitespace, NUL, DEL, 8 bit characters,
+	// and the characters other alphabets use for sextets 62 and 63.
+	template<typename Alphabet>
+	std::vector<char8_t> invalid_characters() {
+		std::vector<char8_t> invalid;
+
+		for (u8 character : u8string_view(u8"=! \n\t\x7F+/-_,.#", 13u)) {
+			if ( 0 > sextet_of<Alphabet>(character) ) {
+				invalid.push_back(character);
+			}
+		}
+
+		invalid.push_back(u8'\0');
+		invalid.push_back(static_cast<char8_t>(0x80u));
+		invalid.push_back(static_cast<char8_t>(0xC3u));
+		invalid.push_back(static_cast<char8_t>(0xFFu));
+
+		return invalid;
+	}
+
+	// Runs one decode kernel on `text`, both into a separate buffer and over the text itself,
+	// and checks what it consumed and wrote. `bad` is the position of the invalid character, if any.
+	template<bool const check_validity, typename Alphabet>
+	void check_decode(
+		named<decode_kernel> const& tested,
+		std::string const& suffix,
+		std::vector<char8_t> const& text,
+		usize bad
+	) {
+		std::string const name = tested.name + suffix;
+		usize length = text.size();
+		usize whole_length = length / 4u * 4u;
+		// checked kernels stop in front of the group holding the invalid character
+		usize expected_consumed = check_validity && bad < whole_length ? bad / 4u * 4u : whole_length;
+		std::vector<char8_t> const expected = reference_decode<Alphabet>(text.data(), expected_consumed);
+
+		std::vector<char8_t> output(whole_length / 4u * 3u + guard_length, guard);
+		usize consumed = tested.kernel(text.data(), length, output.data());
+
+		if (
+			!expect(expected_consumed == consumed, name, "stops at the first invalid group", length, bad)
+			|| !expect(std::equal(expected.begin(), expected.end(), output.begin()), name, "matches the reference", length, bad)
+		) {
+			return;
+		}
+
+		// past a rejected group the kernels may leave scratch, on valid input nothing at all
+		if ( bad >= length ) {
+			expect(guard_intact(output, expected.size()), name, "writes nothing past the result", length);
+		}
+
+		std::vector<char8_t> in_place = text;
+		usize consumed_in_place = tested.kernel(in_place.data(), length, in_place.data());
+
+		expect(expected_consumed == consumed_in_place, name, "stops at the first invalid group in place", length, bad)
+			&& expect(std::equal(expected.begin(), expected.end(), in_place.begin()), name, "matches the reference in place", length, bad);
+	}
+
+	template<typename Alphabet>
+	void test_decode_kernels(
+		std::string const& suffix
+	) {
+		auto const checked = decode_kernels<true, Alphabet>();
+		auto const unchecked = decode_kernels<false, Alphabet>();
+		auto const validators = validate_kernels<Alphabet>();
+		std::vector<char8_t> const invalid = invalid_characters<Alphabet>();
+
+		for (usize length : block_lengths(320u, 2048u, 8u)) {
+			std::vector<char8_t> const text = random_text<Alphabet>(length);
+
+			for (auto const& kernel : checked) {
+				check_decode<true, Alphabet>(kernel, suffix, text, ~usize { 0u });
+			}
+
+			for (auto const& kernel : unchecked) {
+				check_decode<false, Alphabet>(kernel, suffix, text, ~usize { 0u });
+			}
+
+			for (auto const& [name, kernel] : validators) {
+				expect(kernel(text.data(), length), name + suffix, "accepts valid input", length);
+			}
+		}
+
+		// one invalid character at every position, quadratic, so fewer and shorter lengths
+		for (usize length : block_lengths(192u, 768u, 4u)) {
+			std::vector<char8_t> const valid = random_text<Alphabet>(length);
+
+			for (mut<usize> bad = 0u; bad < length; ++bad) {
+				std::vector<char8_t> text = valid;
+
+				text[bad] = invalid[(bad + length) % invalid.size()];
+
+				for (auto const& kernel : checked) {
+					check_decode<true, Alphabet>(kernel, suffix, text, bad);
+				}
+
+				for (auto const& kernel : unchecked) {
+					check_decode<false, Alphabet>(kernel, suffix, text, bad);
+				}
+
+				for (auto const& [name, kernel] : validators) {
+					expect(!kernel(text.data(), length), name + suffix, "rejects an invalid character", length, bad);
+				}
+			}
+		}
+	}
+
+	template<typename Alphabet>
+	void test_kernels(
+		std::string const& alphabet_name
+	) {
+		std::string const suffix = " (" + alphabet_name + ")";
+
+		test_encode_kernels<Alphabet>(suffix);
+		test_encode_lanes_kernels<Alphabet>(suffix);
+		test_decode_kernels<Alphabet>(suffix);
+	}
+
+	u8string_view view(
+		std::vector<char8_t> const& bytes
+	) noexcept {
+		return u8string_view(bytes.data(), bytes.size());
+	}
+
+	// How update() calls or fragments cut up the input: `step` at a time, or for 0,
+	// random sizes from 0 to 40, empty pieces included.
+	constexpr usize steps[] { 0u, 1u, 2u, 3u, 4u, 5u, 7u, 13u, 64u, 1000u };
+
+	std::vector<mut<usize>> cut(
+		usize length,
+		usize step
+	) {
+		std::vector<mut<usize>> pieces;
+
+		for (mut<usize> offset = 0u; offset < length;) {
+			usize piece = std::min<usize>(length - offset, 0u == step ? random_engine() % 41u : step);
+
+			pieces.push_back(piece);
+			offset += piece;
+		}
+
+		return pieces;
+	}
+
+	template<typename Alphabet>
+	void test_streams(
+		std::string const& suffix
+	) {
+		for (usize length : block_lengths(100u, 512u, 2u)) {
+			std::vector<char8_t> const bytes = random_bytes(length);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+
+			for (usize step : steps) {
+				basic_encoder<Alphabet> encoder;
+				u8string encoded;
+				mut<usize> offset = 0u;
+
+				// the same encoder twice, finish() resets it
+				for (mut<int> round = 0; round < 2; ++round) {
+					encoded.clear();
+					offset = 0u;
+
+					for (usize piece : cut(length, step)) {
+						encoder.update(view(bytes).substr(offset, piece), encoded);
+						offset += piece;
+					}
+
+					encoder.finish(encoded);
+
+					expect(text == encoded, "encoder" + suffix, "matches encode", length, step);
+				}
+
+				// into spans of exactly max_update_length()
+				std::vector<char8_t> output;
+
+				offset = 0u;
+
+				for (usize piece : cut(length, step)) {
+					std::vector<char8_t> chunk(basic_encoder<Alphabet>::max_update_length(piece));
+
+					output.insert(output.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(
+						encoder.update(view(bytes).substr(offset, piece), std::span<char8_t>(chunk))
+					));
+					offset += piece;
+				}
+
+				std::vector<char8_t> last(4u);
+
+				output.insert(output.end(), last.begin(), last.begin() + static_cast<std::ptrdiff_t>(encoder.finish(std::span<char8_t>(last))));
+
+				expect(text == view(output), "encoder" + suffix, "matches encode through spans", length, step);
+
+				basic_decoder<Alphabet> decoder;
+				u8string decoded;
+				mut<bool> accepted = true;
+
+				offset = 0u;
+
+				for (usize piece : cut(text.length(), step)) {
+					accepted = decoder.update(u8string_view(text).substr(offset, piece), decoded).has_value() && accepted;
+					offset += piece;
+				}
+
+				if constexpr ( Alphabet::padded ) {
+					accepted = decoder.finish() && accepted;
+				} else {
+					accepted = decoder.finish(decoded).has_value() && accepted;
+				}
+
+				expect(accepted && view(bytes) == decoded, "decoder" + suffix, "round trips", length, step);
+			}
+		}
+
+		// one invalid character at every position, in pieces of every step
+		for (mut<usize> length = 0u; length <= 100u; ++length) {
+			u8string const text = base64::encode<Alphabet>(view(random_bytes(length)));
+
+			for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+				u8string corrupted = text;
+
+				corrupted[bad] = u8'!';
+
+				for (usize step : steps) {
+					basic_decoder<Alphabet> decoder;
+					u8string decoded;
+					mut<bool> accepted = true;
+					mut<usize> offset = 0u;
+
+					for (usize piece : cut(corrupted.length(), step)) {
+						accepted = decoder.update(u8string_view(corrupted).substr(offset, piece), decoded).has_value() && accepted;
+						offset += piece;
+					}
+
+					accepted = decoder.finish(decoded).has_value() && accepted;
+
+					expect(!accepted, "decoder" + suffix, "rejects an invalid character", length, bad);
+				}
+			}
+
+			// cut off in the middle of the last group
+			if constexpr ( Alphabet::padded ) {
+				if ( !text.empty() ) {
+					basic_decoder<Alphabet> decoder;
+					u8string decoded;
+					bool const accepted = decoder.update(u8string_view(text).substr(0u, text.length() - 1u), decoded).has_value();
+
+					expect(!(accepted && decoder.finish()), "decoder" + suffix, "rejects a truncated stream", length);
+				}
+			}
+		}
+	}
+
+	// `text` with a run of 1 to 3 whitespace characters after every piece of cut(text.length(), step),
+	// and half the time one in front of the first.
+	u8string with_whitespace(
+		u8string_view const text,
+		usize step
+	) {
+		constexpr u8string_view whitespace = u8" \t\n\v\f\r";
+
+		u8string spaced;
+		mut<usize> offset = 0u;
+
+		auto const add_run = [&] {
+			for (mut<usize> count = 1u + random_engine() % 3u; 0u < count; --count) {
+				spaced.push_back(whitespace[random_engine() % whitespace.length()]);
+			}
+		};
+
+		if ( 0u != random_engine() % 2u ) {
+			add_run();
+		}
+
+		for (usize piece : cut(text.length(), step)) {
+			spaced.append(text.substr(offset, piece));
+			offset += piece;
+			add_run();
+		}
+
+		return spaced;
+	}
+
+	template<typename Alphabet>
+	void test_skip_whitespace(
+		std::string const& suffix
+	) {
+		for (usize length : block_lengths(100u, 512u, 2u)) {
+			std::vector<char8_t> const bytes = random_bytes(length);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+
+			for (usize step : steps) {
+				u8string const spaced = with_whitespace(text, step);
+				auto const decoded = base64::decode_skip_whitespace<Alphabet>(spaced);
+
+				// nothing but whitespace is as empty as "", which decode() rejects
+				if ( text.empty() ) {
+					expect(!decoded, "decode_skip_whitespace" + suffix, "rejects whitespace only", spaced.length(), step);
+
+					continue;
+				}
+
+				expect(decoded && view(bytes) == *decoded, "decode_skip_whitespace" + suffix, "round trips", length, step);
+
+				// into a span of exactly max_decoded_length()
+				std::vector<char8_t> output(max_decoded_length(spaced.length()) + guard_length, guard);
+				auto const written = base64::decode_skip_whitespace<Alphabet>(spaced,
+					std::span<char8_t>(output.data(), max_decoded_length(spaced.length())));
+
+				expect(written && view(bytes) == u8string_view(output.data(), *written)
+					&& guard_intact(output, max_decoded_length(spaced.length())),
+					"decode_skip_whitespace" + suffix, "round trips through a span", length, step);
+			}
+
+			expect(base64::decode_skip_whitespace<Alphabet>(base64::encode<Alphabet>(view(bytes), line::mime)) == base64::decode<Alphabet>(text),
+				"decode_skip_whitespace" + suffix, "decodes MIME lines", length);
+		}
+
+		// one invalid character at every position, with whitespace all around it
+		for (mut<usize> length = 1u; length <= 60u; ++length) {
+			u8string const text = base64::encode<Alphabet>(view(random_bytes(length)));
+
+			for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+				u8string corrupted = text;
+
+				corrupted[bad] = u8'!';
+
+				for (usize step : { 0u, 1u, 3u, 5u }) {
+					expect(!base64::decode_skip_whitespace<Alphabet>(with_whitespace(corrupted, step)),
+						"decode_skip_whitespace" + suffix, "rejects an invalid character", length, bad);
+				}
+			}
+
+			// cut off in the middle of the last group
+			if constexpr ( Alphabet::padded ) {
+				expect(!base64::decode_skip_whitespace<Alphabet>(with_whitespace(u8string_view(text).substr(0u, text.length() - 1u), 0u)),
+					"decode_skip_whitespace" + suffix, "rejects a truncated input", length);
+			}
+		}
+	}
+
+	// The reference for line wrapping: `text` cut into lines of `format.width`, joined by `format.newline`.
+	u8string reference_wrap(
+		u8string_view const text,
+		line_format const format
+	) {
+		u8string wrapped;
+
+		for (mut<usize> offset = 0u; offset < text.length(); offset += format.width) {
+			if ( 0u != offset ) {
+				wrapped.append(format.newline);
+			}
+
+			wrapped.append(text.substr(offset, format.width));
+		}
+
+		return wrapped;
+	}
+
+	template<typename Alphabet>
+	void test_wrapped(
+		std::string const& suffix
+	) {
+		// around the lines of one wrap chunk (whatever fits into wrap_chunk_size),
+		// and widths of a line per chunk or wider than a chunk
+		line_format const formats[] {
+			line::mime, line::pem, { 4u, u8"\n" }, { 8u, u8"\r\n" }, { 76u, u8"" },
+			{ 1364u, u8"\n" }, { 2048u, u8"\r\n" }, { 4092u, u8"\n" }, { 4096u, u8"\r\n" }, { 8192u, u8"\n" },
+		};
+
+		for (line_format const& format : formats) {
+			usize line_length = format.width / 4u * 3u;
+			usize chunk_lines = std::max<usize>(1u, wrap_chunk_size / (format.width + format.newline.length()));
+
+			std::vector<mut<usize>> lengths;
+
+			for (mut<usize> length = 0u; length <= 100u; ++length) {
+				lengths.push_back(length);
+			}
+
+			for (usize lines : std::initializer_list<usize> { 1u, 2u, 3u, chunk_lines, chunk_lines + 1u, 2u * chunk_lines, 2u * chunk_lines + 1u }) {
+				lengths.insert(lengths.end(), { lines * line_length - 1u, lines * line_length, lines * line_length + 1u });
+			}
+
+			for (usize length : lengths) {
+				std::vector<char8_t> const bytes = random_bytes(length);
+				u8string const expected = reference_wrap(base64::encode<Alphabet>(view(bytes)), format);
+
+				expect(expected.length() == base64::encoded_length<Alphabet>(length, format), "encoded_length(line_format)" + suffix, "matches the wrapped length", length, format.width);
+				expect(expected == base64::encode<Alphabet>(view(bytes), format), "encode(line_format)" + suffix, "matches the reference", length, format.width);
+
+				u8string appended = u8"prefix";
+
+				base64::append_encode<Alphabet>(appended, view(bytes), format);
+
+				expect(u8"prefix" + expected == appended, "append_encode(line_format)" + suffix, "appends the reference", length, format.width);
+
+				// into a span of exactly encoded_length()
+				std::vector<char8_t> output(expected.length() + guard_length, guard);
+				usize written = base64::encode<Alphabet>(view(bytes), format, std::span<char8_t>(output.data(), expected.length()));
+
+				expect(expected == u8string_view(output.data(), written) && guard_intact(output, expected.length()),
+					"encode(line_format)" + suffix, "matches the reference through a span", length, format.width);
+
+				if ( !expected.empty() ) {
+					mut<bool> thrown = false;
+
+					try {
+						base64::encode<Alphabet>(view(bytes), format, std::span<char8_t>(output.data(), expected.length() - 1u));
+					} catch ( std::length_error const& ) {
+						thrown = true;
+					}
+
+					expect(thrown, "encode(line_format)" + suffix, "rejects a span too short", length, format.width);
+				}
+			}
+		}
+
+		for (usize width : { 0u, 1u, 2u, 3u, 5u, 6u, 7u, 75u, 77u, 78u }) {
+			mut<bool> thrown = false;
+
+			try {
+				static_cast<void>(line_format { width, u8"\n" });
+			} catch ( std::invalid_argument const& ) {
+				thrown = true;
+			}
+
+			expect(thrown, "line_format" + suffix, "rejects a width that is no multiple of 4", width);
+		}
+	}
+
+#if defined(__cpp_lib_expected)
+	// What try_decode must report: an incomplete last group, or else the first character that is
+	// neither in the alphabet nor one of the (at most 2) '=' the input ends with.
+	template<typename Alphabet>
+	std::optional<decode_error> reference_error(
+		u8string_view const text
+	) {
+		usize length = text.length();
+
+		if ( 0u == length || (Alphabet::padded ? 0u != length % 4u : 1u == length % 4u) ) {
+			return decode_error { decode_error_kind::invalid_length, length / 4u * 4u };
+		}
+
+		mut<usize> padding = 0u;
+
+		if constexpr ( Alphabet::padded ) {
+			while ( padding < 2u && u8'=' == text[length - 1u - padding] ) {
+				++padding;
+			}
+		}
+
+		for (mut<usize> i = 0u; i < length - padding; ++i) {
+			if ( 0 > sextet_of<Alphabet>(text[i]) ) {
+				return decode_error { u8'=' == text[i] ? decode_error_kind::invalid_padding : decode_error_kind::invalid_character, i };
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	template<typename Alphabet>
+	void check_try_decode(
+		std::string const& suffix,
+		u8string_view const text,
+		usize at
+	) {
+		auto const expected = reference_error<Alphabet>(text);
+		auto const decoded = base64::try_decode<Alphabet>(text);
+		std::vector<char8_t> output(max_decoded_length(text.length()));
+		auto const written = base64::try_decode<Alphabet>(text, std::span<char8_t>(output));
+
+		if ( !expected ) {
+			expect(decoded.has_value() && written.has_value(), "try_decode" + suffix, "accepts valid input", text.length(), at)
+				&& expect(base64::decode<Alphabet>(text) == *decoded, "try_decode" + suffix, "matches decode", text.length(), at)
+				&& expect(*written == decoded->length() && *decoded == view(output).substr(0u, *written), "try_decode" + suffix, "matches decode into a span", text.length(), at);
+
+			return;
+		}
+
+		for (auto const& result : { decoded.has_value() ? std::optional<decode_error>() : decoded.error(), written.has_value() ? std::optional<decode_error>() : written.error() }) {
+			expect(result.has_value(), "try_decode" + suffix, "rejects invalid input", text.length(), at)
+				&& expect(expected->kind == result->kind, "try_decode" + suffix, "reports the kind of error", text.length(), at)
+				&& expect(expected->offset == result->offset, "try_decode" + suffix, "reports the offset of the first error", text.length(), at);
+		}
+	}
+
+	template<typename Alphabet>
+	void test_try_decode(
+		std::string const& suffix
+	) {
+		std::vector<char8_t> invalid = invalid_characters<Alphabet>();
+
+		// '=' in the middle could just as well turn the input into valid padding, those cases come below
+		std::erase(invalid, u8'=');
+
+		for (usize length : block_lengths(100u, 400u, 2u)) {
+			u8string const text = base64::encode<Alphabet>(view(random_bytes(length)));
+
+			check_try_decode<Alphabet>(suffix, text, ~usize { 0u });
+
+			for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+				u8string corrupted = text;
+
+				corrupted[bad] = invalid[(bad + length) % invalid.size()];
+
+				check_try_decode<Alphabet>(suffix, corrupted, bad);
+			}
+
+			// every length that cuts the last group short
+			for (mut<usize> cut_off = 1u; cut_off <= std::min<usize>(3u, text.length()); ++cut_off) {
+				check_try_decode<Alphabet>(suffix, u8string_view(text).substr(0u, text.length() - cut_off), cut_off);
+			}
+		}
+
+		for (u8string_view const text : { u8"", u8"Q", u8"QQ=A", u8"Q===", u8"====", u8"QQ==QUFB", u8"QUFB=QQ=", u8"A=AAQUFB", u8"QUFBQQ=!" }) {
+			check_try_decode<Alphabet>(suffix, text, ~usize { 0u });
+		}
+	}
+#endif
+
+	template<typename Alphabet>
+	void test_decode_in_place(
+		std::string const& suffix
+	) {
+		constexpr usize before = 7u;
+		constexpr usize after = 5u;
+
+		for (usize length : block_lengths(100u, 512u, 2u)) {
+			std::vector<char8_t> const bytes = random_bytes(length);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+
+			// the text in the middle of a bigger buffer, whose other bytes must stay as they are
+			std::vector<char8_t> buffer(before, guard);
+
+			buffer.insert(buffer.end(), text.begin(), text.end());
+			buffer.insert(buffer.end(), after, guard);
+
+			auto const decoded = base64::decode_in_place<Alphabet>(std::span<char8_t>(buffer).subspan(before, text.length()));
+
+			if ( text.empty() ) {
+				expect(!decoded, "decode_in_place" + suffix, "rejects empty input", length);
+
+				continue;
+			}
+
+			expect(decoded && length == *decoded, "decode_in_place" + suffix, "returns the decoded length", length)
+				&& expect(std::equal(bytes.begin(), bytes.end(), buffer.begin() + before), "decode_in_place" + suffix, "round trips", length)
+				&& expect(
+					std::all_of(buffer.begin(), buffer.begin() + before, [](char8_t byte) { return guard == byte; })
+						&& std::all_of(buffer.end() - after, buffer.end(), [](char8_t byte) { return guard == byte; }),
+					"decode_in_place" + suffix, "stays inside its buffer", length
+				);
+
+			// the std::byte overload, on an invalid character at a few positions
+			for (usize bad : { usize { 0u }, text.length() / 2u, text.length() - 1u }) {
+				std::vector<std::byte> corrupted(text.length());
+
+				std::transform(text.begin(), text.end(), corrupted.begin(), [](char8_t character) { return std::byte { character }; });
+				corrupted[bad] = std::byte { u8'!' };
+
+				expect(!base64::decode_in_place<Alphabet>(std::span<std::byte>(corrupted)), "decode_in_place" + suffix, "rejects an invalid character", length, bad);
+			}
+		}
+	}
+
+	// `length` bytes starting at `data`, as fragments of the sizes cut() picks.
+	template<typename Fragment>
+	std::vector<Fragment> fragments_of(
+		ptr<u8> data,
+		usize length,
+		usize step
+	) {
+		std::vector<Fragment> fragments;
+		mut<usize> offset = 0u;
+
+		for (usize piece : cut(length, step)) {
+			fragments.push_back(Fragment(reinterpret_cast<typename Fragment::const_pointer>(data + offset), piece));
+			offset += piece;
+		}
+
+		return fragments;
+	}
+
+	// Output fragments for at least `length` bytes, of random sizes from 0 to 40, and the bytes they cover.
+	struct scattered_output {
+		std::vector<char8_t> storage;
+		std::vector<std::span<char8_t>> fragments;
+
+		explicit scattered_output(
+			usize length
+		) : storage(length + 40u) {
+			mut<usize> offset = 0u;
+
+			while ( offset < length ) {
+				usize piece = std::min<usize>(storage.size() - offset, random_engine() % 41u);
+
+				fragments.push_back(std::span<char8_t>(storage).subspan(offset, piece));
+				offset += piece;
+			}
+		}
+	};
+
+	template<typename Alphabet>
+	void test_fragments(
+		std::string const& suffix
+	) {
+		for (usize length : block_lengths(100u, 512u, 2u)) {
+			std::vector<char8_t> const bytes = random_bytes(length);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+
+			for (usize step : steps) {
+				auto const input = fragments_of<u8string_view>(bytes.data(), length, step);
+
+				expect(text == base64::encode<Alphabet>(input), "encode fragments" + suffix, "matches encode", length, step);
+
+				scattered_output encoded(text.length());
+				usize encoded_length = base64::encode<Alphabet>(input, encoded.fragments);
+
+				expect(text.length() == encoded_length && text == view(encoded.storage).substr(0u, encoded_length),
+					"encode fragments" + suffix, "matches encode into fragments", length, step);
+
+				auto const text_input = fragments_of<std::span<std::byte const>>(text.data(), text.length(), step);
+				auto const decoded = base64::decode<Alphabet>(text_input);
+
+				if ( text.empty() ) {
+					expect(!decoded, "decode fragments" + suffix, "rejects empty input", length, step);
+
+					continue;
+				}
+
+				expect(decoded && view(bytes) == *decoded, "decode fragments" + suffix, "round trips", length, step);
+
+				scattered_output scattered(length);
+				auto const decoded_length = base64::decode<Alphabet>(text_input, scattered.fragments);
+
+				expect(decoded_length && length == *decoded_length && view(bytes) == view(scattered.storage).substr(0u, length),
+					"decode fragments" + suffix, "round trips into fragments", length, step);
+			}
+
+			// output fragments one byte too short
+			if ( 0u != length ) {
+				std::vector<char8_t> storage(text.length() - 1u);
+				std::vector<std::span<char8_t>> output { std::span<char8_t>(storage).first(storage.size() / 2u), std::span<char8_t>(storage).subspan(storage.size() / 2u) };
+				mut<bool> thrown = false;
+
+				try {
+					base64::encode<Alphabet>(fragments_of<u8string_view>(bytes.data(), length, 0u), output);
+				} catch ( std::length_error const& ) {
+					thrown = true;
+				}
+
+				expect(thrown, "encode fragments" + suffix, "throws when the output runs out", length);
+			}
+		}
+
+		// Fragments of the caller that throw partway through the second pass, the one that encodes
+		// or decodes into the string (with C++23, inside resize_and_overwrite()).
+		{
+			std::vector<char8_t> const bytes = random_bytes(100u);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+			auto const bytes_input = fragments_of<u8string_view>(bytes.data(), bytes.size(), 7u);
+			auto const text_input = fragments_of<u8string_view>(text.data(), text.length(), 7u);
+
+			auto const throwing = [](
+				std::vector<u8string_view> const& fragments,
+				mut<usize>& seen
+			) {
+				return fragments | std::views::transform([&fragments, &seen](u8string_view const fragment) {
+					if ( fragments.size() + fragments.size() / 2u < ++seen ) {
+						throw std::runtime_error("fragment");
+					}
+
+					return fragment;
+				});
+			};
+
+			mut<usize> seen = 0u;
+			mut<bool> thrown = false;
+
+			try {
+				base64::encode<Alphabet>(throwing(bytes_input, seen));
+			} catch ( std::runtime_error const& ) {
+				thrown = true;
+			}
+
+			expect(thrown, "encode fragments" + suffix, "passes on an exception of the input", bytes.size());
+
+			seen = 0u;
+			thrown = false;
+
+			try {
+				base64::decode<Alphabet>(throwing(text_input, seen));
+			} catch ( std::runtime_error const& ) {
+				thrown = true;
+			}
+
+			expect(thrown, "decode fragments" + suffix, "passes on an exception of the input", text.length());
+		}
+
+		// one invalid character at every position, with fragment boundaries all around it
+		for (mut<usize> length = 1u; length <= 60u; ++length) {
+			u8string const text = base64::encode<Alphabet>(view(random_bytes(length)));
+
+			for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+				u8string corrupted = text;
+
+				corrupted[bad] = u8'!';
+
+				for (usize step : { 0u, 1u, 3u, 5u }) {
+					expect(!base64::decode<Alphabet>(fragments_of<u8string_view>(corrupted.data(), corrupted.length(), step)),
+						"decode fragments" + suffix, "rejects an invalid character", length, bad);
+				}
+			}
+		}
+	}
+
+	// The fixed size overloads for one `length`, against the ones for any length.
+	template<typename Alphabet, usize length>
+	void check_fixed_size(
+		std::string const& suffix
+	) {
+		std::vector<char8_t> const bytes = random_bytes(length);
+		std::array<std::byte, length> input;
+
+		std::transform(bytes.begin(), bytes.end(), input.begin(), [](char8_t const byte) { return std::byte { byte }; });
+
+		u8string const text = base64::encode<Alphabet>(view(bytes));
+		auto const encoded = base64::encode<length, Alphabet>(std::span<std::byte const, length>(input));
+
+		expect(text == u8string_view(encoded.data(), encoded.size()), "encode<N>" + suffix, "matches encode", length);
+
+		auto const decoded = base64::decode<length, Alphabet>(text);
+
+		expect(decoded && input == *decoded, "decode<N>" + suffix, "round trips", length);
+
+		for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+			u8string corrupted = text;
+
+			corrupted[bad] = u8'!';
+
+			expect(!base64::decode<length, Alphabet>(corrupted), "decode<N>" + suffix, "rejects an invalid character", length, bad);
+		}
+
+		// the input has to be exactly encoded_length(N) characters
+		expect(!base64::decode<length, Alphabet>(text + u8"AAAA"), "decode<N>" + suffix, "rejects a group too many", length);
+
+		if ( !text.empty() ) {
+			expect(!base64::decode<length, Alphabet>(u8string_view(text).substr(0u, text.length() - 1u)), "decode<N>" + suffix, "rejects a cut off input", length);
+		}
+	}
+
+	template<typename Alphabet, usize... length>
+	void test_fixed_size(
+		std::string const& suffix,
+		std::index_sequence<length...>
+	) {
+		(check_fixed_size<Alphabet, length>(suffix), ...);
+	}
+
+	// Onto a string with and without spare capacity; an invalid input must leave it as it was.
+	template<typename Alphabet>
+	void test_append(
+		std::string const& suffix
+	) {
+		u8string const prefix = u8"prefix";
+
+		for (mut<usize> length = 0u; length <= 100u; ++length) {
+			std::vector<char8_t> const bytes = random_bytes(length);
+			u8string const text = base64::encode<Alphabet>(view(bytes));
+
+			for (usize spare : { 0u, 1000u }) {
+				u8string encoded = prefix;
+				u8string decoded = prefix;
+
+				encoded.reserve(prefix.length() + spare);
+				decoded.reserve(prefix.length() + spare);
+
+				usize added = base64::append_encode<Alphabet>(encoded, view(bytes));
+
+				expect(text.length() == added && prefix + text == encoded, "append_encode" + suffix, "appends encode", length, spare);
+
+				if ( text.empty() ) {
+					continue;
+				}
+
+				auto const decoded_length = base64::append_decode<Alphabet>(decoded, text);
+
+				expect(decoded_length && length == *decoded_length && prefix + u8string(view(bytes)) == decoded,
+					"append_decode" + suffix, "appends decode", length, spare);
+
+				for (mut<usize> bad = 0u; bad < text.length(); ++bad) {
+					u8string corrupted = text;
+					u8string unchanged = prefix;
+
+					corrupted[bad] = u8'!';
+					unchanged.reserve(prefix.length() + spare);
+
+					expect(!base64::append_decode<Alphabet>(unchanged, corrupted) && prefix == unchanged,
+						"append_decode" + suffix, "leaves the string unchanged for an invalid character", length, bad);
+				}
+
+				u8string unchanged = prefix;
+
+				unchanged.reserve(prefix.length() + spare);
+
+				// a single character after the last whole group
+				expect(!base64::append_decode<Alphabet>(unchanged, text.substr(0u, text.length() / 4u * 4u) + u8"A") && prefix == unchanged,
+					"append_decode" + suffix, "leaves the string unchanged for an incomplete group", length, spare);
+			}
+		}
+	}
+
+	// Batches of 0 to 40 items of 0 to 80 bytes, short ones that go through the lanes, empty ones and long ones,
+	// all into the same `batch` one after the other.
+	template<typename Alphabet>
+	void test_batch(
+		std::string const& suffix
+	) {
+		base64::batch encoded;
+		base64::batch decoded;
+
+		for (usize count : { 0u, 1u, 7u, 8u, 9u, 17u, 40u }) {
+			std::vector<std::vector<char8_t>> bytes;
+			std::vector<u8string> texts;
+
+			for (mut<usize> i = 0u; i < count; ++i) {
+				bytes.push_back(random_bytes(0u == i % 5u ? 0u : random_engine() % 81u));
+				texts.push_back(base64::encode<Alphabet>(view(bytes.back())));
+			}
+
+			std::vector<u8string_view> items;
+
+			for (auto const& item : bytes) {
+				items.push_back(view(item));
+			}
+
+			// a fresh batch, then the reused one
+			base64::batch const fresh = base64::encode_batch<Alphabet>(items);
+
+			base64::encode_batch<Alphabet>(items, encoded);
+
+			mut<bool> matches = count == fresh.size() && count == encoded.size();
+
+			for (mut<usize> i = 0u; i < count && matches; ++i) {
+				matches = texts[i] == fresh[i] && texts[i] == encoded[i];
+			}
+
+			expect(matches, "encode_batch" + suffix, "matches encode", count);
+
+			// decode("") is rejected, so are batches with an empty item
+			std::vector<u8string_view> const text_items(texts.begin(), texts.end());
+			bool const valid = std::none_of(texts.begin(), texts.end(), [](u8string const& text) { return text.empty(); });
+			auto const fresh_decoded = base64::decode_batch<Alphabet>(text_items);
+
+			if ( valid ) {
+				expect(base64::decode_batch<Alphabet>(text_items, decoded) && fresh_decoded, "decode_batch" + suffix, "accepts valid items", count);
+
+				matches = fresh_decoded && count == fresh_decoded->size() && count == decoded.size();
+
+				for (mut<usize> i = 0u; i < count && matches; ++i) {
+					matches = view(bytes[i]) == (*fresh_decoded)[i] && view(bytes[i]) == decoded[i];
+				}
+
+				expect(matches, "decode_batch" + suffix, "round trips", count);
+			} else {
+				expect(!base64::decode_batch<Alphabet>(text_items, decoded) && !fresh_decoded && 0u == decoded.size() && decoded.arena.empty(),
+					"decode_batch" + suffix, "rejects an empty item", count);
+			}
+		}
+
+		// reused for a batch no bigger than the last one, the arena is not allocated again
+		std::vector<char8_t> const big = random_bytes(3000u);
+		u8string_view const big_items[] { view(big), view(big).substr(0u, 20u), view(big).substr(0u, 100u) };
+
+		base64::encode_batch<Alphabet>(big_items, encoded);
+
+		ptr<char8_t const> arena = encoded.arena.data();
+
+		base64::encode_batch<Alphabet>(std::span<u8string_view const>(big_items).subspan(1u), encoded);
+
+		expect(arena == encoded.arena.data() && base64::encode<Alphabet>(big_items[2]) == encoded[1u], "encode_batch" + suffix, "reuses the arena", 2u);
+
+		// one invalid character in one of the items: nothing is decoded
+		for (mut<usize> bad = 0u; bad < 8u; ++bad) {
+			std::vector<u8string> texts;
+
+			for (mut<usize> i = 0u; i < 8u; ++i) {
+				texts.push_back(base64::encode<Alphabet>(view(random_bytes(1u + random_engine() % 40u))));
+			}
+
+			texts[bad][random_engine() % texts[bad].length()] = u8'!';
+
+			std::vector<u8string_view> const text_items(texts.begin(), texts.end());
+
+			base64::decode_batch<Alphabet>(std::span<u8string_view const>(text_items).first(bad), decoded);
+
+			expect(!base64::decode_batch<Alphabet>(text_items) && !base64::decode_batch<Alphabet>(text_items, decoded)
+				&& 0u == decoded.size() && decoded.arena.empty(), "decode_batch" + suffix, "rejects the whole batch for one invalid item", 8u, bad);
+		}
+	}
+
+	template<typename Alphabet>
+	void test_api(
+		std::string const& alphabet_name
+	) {
+		std::string const suffix = " (" + alphabet_name + ")";
+
+		test_streams<Alphabet>(suffix);
+		test_skip_whitespace<Alphabet>(suffix);
+		test_wrapped<Alphabet>(suffix);
+#if defined(__cpp_lib_expected)
+		test_try_decode<Alphabet>(suffix);
+#endif
+		test_decode_in_place<Alphabet>(suffix);
+		test_fragments<Alphabet>(suffix);
+		test_fixed_size<Alphabet>(suffix, std::make_index_sequence<50u> {});
+		test_append<Alphabet>(suffix);
+		test_batch<Alphabet>(suffix);
+	}
+
+	// Big enough for several chunks of parallel::chunk_length(), and ending in "==".
+	constexpr usize parallel_length = 3u * (usize { 1u } << 20u) + 1000u;
+	constexpr usize parallel_threads = 4u;
+
+	void test_parallel() {
+		std::vector<char8_t> const bytes = random_bytes(parallel_length);
+		u8string const text = base64::encode(view(bytes));
+		usize chunk = parallel::chunk_length(text.length(), parallel_threads, 4u);
+
+		expect(text == base64::parallel::encode(view(bytes), parallel_threads), "parallel::encode", "matches encode", parallel_length);
+		expect(view(bytes) == base64::parallel::decode(text, parallel_threads), "parallel::decode", "round trips", parallel_length);
+
+		// an invalid character on either side of every chunk boundary, at both ends of the input
+		// and in the last group, which holds the padding
+		std::vector<mut<usize>> positions { 0u, 1u, text.length() - 5u, text.length() - 4u, text.length() - 3u, text.length() - 1u };
+
+		for (mut<usize> boundary = chunk; boundary < text.length(); boundary += chunk) {
+			positions.insert(positions.end(), { boundary - 4u, boundary - 1u, boundary, boundary + 1u, boundary + 3u });
+		}
+
+		for (usize bad : positions) {
+			for (char8_t const invalid : { u8'!', u8'=' }) {
+				u8string corrupted = text;
+
+				corrupted[bad] = invalid;
+
+				// '=' instead of the first '=' is no error
+				if ( corrupted == text ) {
+					continue;
+				}
+
+				expect(!base64::parallel::decode(corrupted, parallel_threads), "parallel::decode", "rejects an invalid character", text.length(), bad);
+#if defined(__cpp_lib_expected)
+				auto const expected = reference_error<alphabet::standard>(corrupted);
+				auto const result = base64::parallel::try_decode(corrupted, parallel_threads);
+
+				expect(!result.has_value(), "parallel::try_decode", "rejects an invalid character", text.length(), bad)
+					&& expect(expected->kind == result.error().kind, "parallel::try_decode", "reports the kind of error", text.length(), bad)
+					&& expect(expected->offset == result.error().offset, "parallel::try_decode", "reports the offset of the first error", text.length(), bad);
+#endif
+			}
+		}
+
+#if defined(__cpp_lib_expected)
+		auto const decoded = base64::parallel::try_decode(text, parallel_threads);
+
+		expect(decoded.has_value() && view(bytes) == *decoded, "parallel::try_decode", "round trips", parallel_length);
+
+		// two bad chunks, the earlier one is reported
+		u8string corrupted = text;
+
+		corrupted[2u * chunk + 6u] = u8'!';
+		corrupted[chunk + 9u] = u8'!';
+
+		auto const result = base64::parallel::try_decode(corrupted, parallel_threads);
+
+		expect(!result.has_value() && chunk + 9u == result.error().offset, "parallel::try_decode", "reports the first of two errors", text.length(), chunk + 9u);
+
+		auto const cut_off = base64::parallel::try_decode(u8string_view(text).substr(0u, text.length() - 1u), parallel_threads);
+
+		expect(!cut_off.has_value() && decode_error_kind::invalid_length == cut_off.error().kind
+			&& text.length() - 4u == cut_off.error().offset, "parallel::try_decode", "reports an incomplete last group", text.length() - 1u);
+#endif
+
+		// An executor that takes 2 tasks and then throws: the 2 still have to finish
+		// before the exception gets out, they refer to the caller's stack.
+		std::vector<std::jthread> threads;
+		std::atomic<mut<usize>> finished { 0u };
+		mut<bool> thrown = false;
+
+		auto const throwing_executor = [&](std::function<void()> task) {
+			if ( 2u == threads.size() ) {
+				throw std::runtime_error("executor is full");
+			}
+
+			threads.emplace_back([task = std::move(task)] {
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				task();
+			});
+		};
+
+		try {
+			parallel::run_on_executor(throwing_executor, 4u, [&](usize) noexcept {
+				++finished;
+			});
+		} catch ( std::runtime_error const& ) {
+			thrown = true;
+		}
+
+		expect(thrown && 2u == finished, "parallel::run_on_executor", "waits for the tasks it posted before throwing", 4u);
+
+		// The same executor behind encode / decode / try_decode, which run the chunks while the result
+		// is being written into the string (with C++23, inside resize_and_overwrite()), so that
+		// the exception has to be carried out of there. The public overloads cut the input into
+		// as many chunks as there are hardware threads, so they only call the executor with 2 or more;
+		// the functions behind them are called with parallel_threads as well.
+		auto const executor_throws = [&](
+			std::string_view const test,
+			auto const& call
+		) {
+			mut<bool> thrown = false;
+
+			threads.clear();
+
+			try {
+				call();
+			} catch ( std::runtime_error const& ) {
+				thrown = true;
+			}
+
+			expect(thrown, test, "passes on the exception of the executor", text.length());
+		};
+
+		auto const run = [&](usize count, auto const& task) {
+			parallel::run_on_executor(throwing_executor, count, task);
+		};
+
+		executor_throws("parallel::_encode", [&] { parallel::_encode<alphabet::standard>(view(bytes), parallel_threads, run); });
+		executor_throws("parallel::_decode", [&] { parallel::_decode<alphabet::standard>(text, parallel_threads, run); });
+#if defined(__cpp_lib_expected)
+		executor_throws("parallel::_try_decode", [&] { parallel::_try_decode<alphabet::standard>(text, parallel_threads, run); });
+#endif
+
+		if ( 2u <= parallel::hardware_threads() ) {
+			executor_throws("parallel::encode", [&] { base64::parallel::encode(view(bytes), throwing_executor); });
+			executor_throws("parallel::decode", [&] { base64::parallel::decode(text, throwing_executor); });
+#if defined(__cpp_lib_expected)
+			executor_throws("parallel::try_decode", [&] { base64::parallel::try_decode(text, throwing_executor); });
+#endif
+		} else {
+			threads.clear();
+
+			expect(text == base64::parallel::encode(view(bytes), throwing_executor), "parallel::encode", "matches encode in one chunk", parallel_length);
+			expect(view(bytes) == base64::parallel::decode(text, throwing_executor), "parallel::decode", "round trips in one chunk", parallel_length);
+#if defined(__cpp_lib_expected)
+			expect(view(bytes) == base64::parallel::try_decode(text, throwing_executor).value_or(u8string()), "parallel::try_decode", "round trips in one chunk", parallel_length);
+#endif
+		}
+	}
+
+#if defined(BASE64_INSTRUMENT)
+	instrument::site site_named(
+		std::string_view const name
+	) {
+		return static_cast<instrument::site>(std::find(instrument::site_names.begin(), instrument::site_names.end(), name) - instrument::site_names.begin());
+	}
+
+	// Known calls between two snapshots, one of them on a thread that has exited by the second.
+	void test_instrument() {
+		using instrument::site;
+
+		std::vector<char8_t> const bytes = random_bytes(1000u);
+		u8string const text = base64::encode(view(bytes));
+		u8string corrupted = text;
+
+		corrupted[500u] = u8'!';
+
+		std::vector<char8_t> const items[] { random_bytes(5u), random_bytes(20u), random_bytes(100u) };
+		u8string_view const item_views[] { view(items[0u]), view(items[1u]), view(items[2u]) };
+
+		auto const before = instrument::snapshot();
+
+		base64::encode(view(bytes));
+		base64::encode(u8string_view());
+		base64::encode(view(items[0u]));
+		base64::decode(text);
+		base64::decode(corrupted);
+		base64::validate(text);
+		std::thread([&] { base64::decode(text); }).join();
+		base64::encode_batch(item_views);
+
+		auto const counted = instrument::snapshot() - before;
+		auto const& encodes = counted[site::encode];
+		auto const& decodes = counted[site::decode];
+		auto const& validates = counted[site::validate];
+		auto const& batches = counted[site::encode_batch];
+
+		expect(3u == encodes.calls && 1005u == encodes.bytes && 0u == encodes.rejected, "instrument", "counts encode calls and bytes", 1005u);
+		// bit_width(): 0 for the empty input, 3 for 5 bytes, 10 for 1000
+		expect(1u == encodes.sizes[0u] && 1u == encodes.sizes[3u] && 1u == encodes.sizes[10u], "instrument", "sorts encode lengths into log2 buckets", 1005u);
+		expect(3u == decodes.calls && 3u * text.length() == decodes.bytes && 1u == decodes.rejected, "instrument", "counts decode calls of exited threads and rejections", text.length());
+		expect(1u == validates.calls && text.length() == validates.bytes && 0u == validates.rejected, "instrument", "counts validate calls", text.length());
+		expect(3u == batches.calls && 125u == batches.bytes, "instrument", "counts every item of a batch", 125u);
+		expect(0u == counted[site::decode_nocheck].calls && 0u == counted[site::parallel_encode].calls, "instrument", "counts nothing that wasn't called", 0u);
+
+		// the dispatchers pick the widest kernel, the last one of each table
+		auto const encode_kernel_names = encode_kernels<alphabet::standard>();
+		auto const decode_kernel_names = decode_kernels<true, alphabet::standard>();
+
+		for (auto const& kernel : encode_kernel_names) {
+			bool const picked = &kernel == &encode_kernel_names.back();
+
+			expect(picked == (0u != counted[site_named(kernel.name)].calls), "instrument", "counts the encode kernel that was picked", 0u);
+		}
+
+		for (auto const& kernel : decode_kernel_names) {
+			bool const picked = &kernel == &decode_kernel_names.back();
+
+			expect(picked == (0u != counted[site_named(kernel.name)].calls), "instrument", "counts the decode kernel that was picked", 0u);
+		}
+	}
+#endif
+
+	void print_kernels() {
+		std::printf("kernels:");
+
+		for (auto const& kernel : encode_kernels<alphabet::standard>()) {
+			std::printf(" %s", kernel.name.c_str());
+		}
+
+		for (auto const& kernel : encode_lanes_kernels<alphabet::standard>()) {
+			std::printf(" %s", kernel.name.c_str());
+		}
+
+		for (auto const& kernel : decode_kernels<true, alphabet::standard>()) {
+			std::printf(" %s", kernel.name.c_str());
+		}
+
+		for (auto const& kernel : decode_kernels<false, alphabet::standard>()) {
+			std::printf(" %s", kernel.name.c_str());
+		}
+
+		for (auto const& kernel : validate_kernels<alphabet::standard>()) {
+			std::printf(" %s", kernel.name.c_str());
+		}
+
+		std::printf("\n");
+	}
+
+} // namespace
+
+int main() {
+#if BASE64_X86_SIMD
+	__builtin_cpu_init();
+#endif
+
+	print_kernels();
+
+	test_kernels<alphabet::standard>("standard");
+	test_kernels<alphabet::url>("url");
+	test_kernels<alphabet::bcrypt>("bcrypt");
+	test_kernels<scrambled>("scrambled");
+
+	test_api<alphabet::standard>("standard");
+	test_api<alphabet::url_unpadded>("url_unpadded");
+	test_parallel();
+#if defined(BASE64_INSTRUMENT)
+	test_instrument();
+#endif
+
+	std::printf("%zu checks, %zu failed\n", checks, failures);
+
+	return 0u == failures ? 0 : 1;
+}
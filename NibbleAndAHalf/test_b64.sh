@@ -0,0 +1,113 @@
+#!/bin/sh
+#
+#  test_b64.sh
+#  NibbleAndAHalf
+#
+#  Checks the b64 command line tool against coreutils base64, reading from a mapped file,
+#  from a pipe and writing into a mapped output file, and checks that bad options are rejected.
+#
+#    g++ -std=c++20 -O2 b64.cpp -o b64 && sh test_b64.sh ./b64
+#
+#  Every failed case is printed and the exit status is 1 if any failed.
+#
+
+b64=${1:-./b64}
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+checks=0
+failures=0
+
+fail() {
+	failures=$((failures + 1))
+	echo "FAIL $*"
+}
+
+# expect_same NAME FILE ARGUMENTS...: b64 and base64 give the same output and status for FILE
+expect_same() {
+	name=$1
+	input=$2
+	shift 2
+	checks=$((checks + 1))
+
+	base64 "$@" "$input" > "$work/expected" 2> /dev/null
+	expected_status=$?
+
+	"$b64" "$@" "$input" > "$work/mapped" 2> /dev/null
+	mapped_status=$?
+	"$b64" "$@" < "$input" > "$work/redirected" 2> /dev/null
+	cat "$input" | "$b64" "$@" > "$work/piped" 2> /dev/null
+	piped_status=$?
+	rm -f "$work/written"
+	"$b64" "$@" --mmap-output "$input" "$work/written" 2> /dev/null
+
+	if [ 0 = "$expected_status" ] && [ 0 != "$mapped_status" ]; then
+		fail "$name: exit status $mapped_status"
+	elif [ 0 != "$expected_status" ] && { [ 0 = "$mapped_status" ] || [ 0 = "$piped_status" ]; }; then
+		fail "$name: accepted"
+	elif [ 0 = "$expected_status" ]; then
+		for output in mapped redirected piped written; do
+			cmp -s "$work/expected" "$work/$output" || fail "$name: $output output differs"
+		done
+	fi
+}
+
+# expect_rejected NAME ARGUMENTS...: b64 exits with 2 without writing anything
+expect_rejected() {
+	name=$1
+	shift
+	checks=$((checks + 1))
+
+	"$b64" "$@" < /dev/null > "$work/output" 2> /dev/null
+	status=$?
+
+	if [ 2 != "$status" ] || [ -s "$work/output" ]; then
+		fail "$name: exit status $status"
+	fi
+}
+
+: > "$work/empty"
+printf 'a' > "$work/one"
+head -c 1000 /dev/urandom > "$work/small"
+# longer than the 4 MiB chunks, and not a whole number of groups
+head -c 9000001 /dev/urandom > "$work/large"
+
+for data in empty one small large; do
+	for wrap in 76 0 4 64 1000000 8000000 16777216; do
+		expect_same "encode $data -w $wrap" "$work/$data" -w "$wrap"
+	done
+
+	base64 -w 76 "$work/$data" > "$work/$data.b64"
+	base64 -w 0 "$work/$data" > "$work/$data.line.b64"
+	expect_same "decode $data" "$work/$data.b64" -d
+	expect_same "decode $data in one line" "$work/$data.line.b64" -d
+done
+
+# encodings put together with cat: a padded group ends one and the next starts after it
+cat "$work/one.b64" "$work/small.b64" "$work/one.line.b64" > "$work/concatenated"
+cat "$work/large.line.b64" "$work/one.line.b64" "$work/large.line.b64" > "$work/concatenated_large"
+printf 'AA=\n=AAA=QUJD' > "$work/concatenated_split"
+
+for data in concatenated concatenated_large concatenated_split; do
+	expect_same "decode $data" "$work/$data" -d
+done
+
+printf 'AAA' > "$work/truncated"
+printf 'AA=A' > "$work/misplaced"
+printf 'AA==AAA' > "$work/truncated_after_padding"
+printf 'AA!A' > "$work/invalid"
+
+for data in truncated misplaced truncated_after_padding invalid; do
+	expect_same "decode $data" "$work/$data" -d
+done
+
+for wrap in '' -4 +4 ' 4' 4x 18446744073709551620 3; do
+	expect_rejected "-w '$wrap'" -w "$wrap"
+done
+
+expect_rejected "-w without a size" -w
+expect_rejected "unknown option" --bogus
+
+echo "$checks checks, $failures failed"
+
+[ 0 = "$failures" ]